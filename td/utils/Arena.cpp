@@ -0,0 +1,44 @@
+#include "td/utils/Arena.h"
+
+#include "td/utils/port/thread_local.h"
+
+namespace td {
+
+void *Arena::allocate_slow(size_t size, size_t alignment) {
+  CHECK(alignment <= alignof(std::max_align_t));
+  // blocks after the current one are unused, so they are reused or replaced by bigger blocks
+  auto block = blocks_.empty() ? 0 : block_ + 1;
+  if (block == blocks_.size() || blocks_[block].size < size) {
+    auto block_size = td::max(next_block_size_, size);
+    Block new_block{std::unique_ptr<char[]>(new char[block_size]), block_size};
+    memory_size_ += block_size;
+    if (block == blocks_.size()) {
+      blocks_.push_back(std::move(new_block));
+    } else {
+      memory_size_ -= blocks_[block].size;
+      blocks_[block] = std::move(new_block);
+    }
+    size_t max_block_size = MAX_BLOCK_SIZE;
+    next_block_size_ = td::min(next_block_size_ * 2, max_block_size);
+  }
+  set_block(block);
+  // blocks are allocated by new[], so they are aligned to alignof(std::max_align_t)
+  pos_ = size;
+  return begin_;
+}
+
+void Arena::free_unused_blocks() {
+  // blocks after the current one are unused, so they can be freed
+  while (memory_size_ > MAX_RETAINED_SIZE && blocks_.size() > block_ + 1) {
+    memory_size_ -= blocks_.back().size;
+    blocks_.pop_back();
+  }
+}
+
+Arena &Arena::get_thread_local() {
+  static TD_THREAD_LOCAL Arena *arena;  // static zero-initialized
+  init_thread_local<Arena>(arena);
+  return *arena;
+}
+
+}  // namespace td
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace td {
+
+// Monotonic allocator. Memory is bump-allocated from a chain of blocks and is freed only by rewind() or reset(),
+// so destructors of objects created in the arena are never called.
+// Blocks are kept after rewind() and reused by subsequent allocations, so an arena,
+// which is rewound after each request, doesn't allocate memory in a steady state.
+// Unused blocks above MAX_RETAINED_SIZE are freed by rewind(), so a single big request doesn't pin its peak memory
+class Arena {
+ public:
+  struct Marker {
+    size_t block;
+    size_t pos;
+  };
+
+  explicit Arena(size_t first_block_size = DEFAULT_FIRST_BLOCK_SIZE) : next_block_size_(first_block_size) {
+  }
+  Arena(const Arena &other) = delete;
+  Arena &operator=(const Arena &other) = delete;
+  Arena(Arena &&other) = delete;
+  Arena &operator=(Arena &&other) = delete;
+  ~Arena() = default;
+
+  // alignment must be a power of two not greater than alignof(std::max_align_t)
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+    auto pos = (pos_ + alignment - 1) & ~(alignment - 1);
+    if (unlikely(pos > size_ || size > size_ - pos)) {
+      return allocate_slow(size, alignment);
+    }
+    pos_ = pos + size;
+    return begin_ + pos;
+  }
+
+  // only the last allocation can be freed before rewind(); other memory is freed by rewind() or reset()
+  void deallocate(void *ptr, size_t size) {
+    if (static_cast<char *>(ptr) + size == begin_ + pos_) {
+      pos_ = static_cast<size_t>(static_cast<char *>(ptr) - begin_);
+    }
+  }
+
+  template <class T, class... ArgsT>
+  T *create(ArgsT &&... args) {
+    static_assert(std::is_trivially_destructible<T>::value, "Destructors of objects in Arena are never called");
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<ArgsT>(args)...);
+  }
+
+  MutableSlice copy(Slice slice) {
+    auto ptr = static_cast<char *>(allocate(slice.size(), 1));
+    if (!slice.empty()) {
+      std::memcpy(ptr, slice.data(), slice.size());
+    }
+    return MutableSlice(ptr, slice.size());
+  }
+
+  Marker get_marker() const {
+    return Marker{block_, pos_};
+  }
+
+  // frees all memory allocated after the marker was got
+  void rewind(Marker marker) {
+    CHECK(marker.block < block_ || (marker.block == block_ && marker.pos <= pos_));
+    if (marker.block != block_) {
+      set_block(marker.block);
+      if (memory_size_ > MAX_RETAINED_SIZE) {
+        free_unused_blocks();
+      }
+    }
+    pos_ = marker.pos;
+  }
+
+  void reset() {
+    rewind(Marker{0, 0});
+  }
+
+  // returns total size of the blocks
+  size_t get_memory_size() const {
+    return memory_size_;
+  }
+
+  // the arena of the current thread, which can be used by functions, which need temporary memory;
+  // the memory must be freed before return, preferably with ArenaScope
+  static Arena &get_thread_local();
+
+ private:
+  static constexpr size_t DEFAULT_FIRST_BLOCK_SIZE = 1 << 12;
+  static constexpr size_t MAX_BLOCK_SIZE = 1 << 20;
+  static constexpr size_t MAX_RETAINED_SIZE = 4 * MAX_BLOCK_SIZE;
+
+  struct Block {
+    std::unique_ptr<char[]> mem;
+    size_t size;
+  };
+  vector<Block> blocks_;
+  size_t next_block_size_;
+  size_t memory_size_ = 0;
+
+  // the current block
+  size_t block_ = 0;
+  char *begin_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+
+  void set_block(size_t block) {
+    block_ = block;
+    begin_ = blocks_[block].mem.get();
+    size_ = blocks_[block].size;
+  }
+
+  void *allocate_slow(size_t size, size_t alignment);
+
+  void free_unused_blocks();
+};
+
+// Frees all memory allocated in the arena during the lifetime of the scope
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena &arena = Arena::get_thread_local()) : arena_(arena), marker_(arena.get_marker()) {
+  }
+  ArenaScope(const ArenaScope &other) = delete;
+  ArenaScope &operator=(const ArenaScope &other) = delete;
+  ArenaScope(ArenaScope &&other) = delete;
+  ArenaScope &operator=(ArenaScope &&other) = delete;
+  ~ArenaScope() {
+    arena_.rewind(marker_);
+  }
+
+  Arena &arena() {
+    return arena_;
+  }
+
+ private:
+  Arena &arena_;
+  Arena::Marker marker_;
+};
+
+// Allocator for standard containers, which allocates memory from an Arena
+template <class T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  explicit ArenaAllocator(Arena &arena) noexcept : arena_(&arena) {
+  }
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept : arena_(other.arena_) {
+  }
+
+  T *allocate(size_t n) {
+    CHECK(n <= std::numeric_limits<size_t>::max() / sizeof(T));
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T *ptr, size_t n) noexcept {
+    arena_->deallocate(ptr, n * sizeof(T));
+  }
+
+  Arena &get_arena() const {
+    return *arena_;
+  }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U> &other) const {
+    return arena_ == other.arena_;
+  }
+  template <class U>
+  bool operator!=(const ArenaAllocator<U> &other) const {
+    return arena_ != other.arena_;
+  }
+
+ private:
+  template <class U>
+  friend class ArenaAllocator;
+
+  Arena *arena_;
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace td
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "td/utils/common.h"
+#include "td/utils/Status.h"
 
+#include <atomic>
+#include <memory>
 #include <utility>
 
 namespace td {
@@ -52,4 +55,71 @@ class ChangesProcessor {
   }
 };
 
+// Concurrent version of ChangesProcessor. Changes are added by one thread and are processed in order of addition
+// by one thread, possibly another one, but can be finished by any thread
+template <class DataT>
+class ConcurrentChangesProcessor {
+ public:
+  using Id = uint64;
+
+  // at most capacity changes can be added, but not processed yet
+  explicit ConcurrentChangesProcessor(size_t capacity = 1024) {
+    while (capacity_ < capacity) {
+      capacity_ *= 2;
+    }
+    slots_ = std::make_unique<Slot[]>(capacity_);
+  }
+
+  // must be called only from the producer thread
+  template <class FromDataT>
+  Result<Id> add(FromDataT &&data) {
+    auto id = next_id_;
+    if (id - processed_id_.load(std::memory_order_acquire) >= capacity_) {
+      return Status::Error("Too many unprocessed changes");
+    }
+    slots_[id & (capacity_ - 1)].data = std::forward<FromDataT>(data);
+    next_id_++;
+    return id;
+  }
+
+  // can be called from any thread, but only once for each change
+  void finish(Id token) {
+    slots_[token & (capacity_ - 1)].finished_id.store(token, std::memory_order_release);
+  }
+
+  // must be called only from the consumer thread; returns number of processed changes
+  template <class F>
+  size_t process_finished(F &&func) {
+    auto id = processed_id_.load(std::memory_order_relaxed);
+    auto begin_id = id;
+    while (true) {
+      auto &slot = slots_[id & (capacity_ - 1)];
+      if (slot.finished_id.load(std::memory_order_acquire) != id) {
+        break;
+      }
+      func(std::move(slot.data));
+      id++;
+    }
+    if (id != begin_id) {
+      processed_id_.store(id, std::memory_order_release);
+    }
+    return static_cast<size_t>(id - begin_id);
+  }
+
+ private:
+  struct Slot {
+    // the slot is finished if finished_id is equal to the identifier of the change, stored in it
+    std::atomic<Id> finished_id{0};
+    DataT data;
+  };
+  size_t capacity_ = 1;
+  std::unique_ptr<Slot[]> slots_;
+
+  char pad_[TD_CONCURRENCY_PAD];
+  Id next_id_ = 1;
+  char pad2_[TD_CONCURRENCY_PAD - sizeof(Id)];
+  std::atomic<Id> processed_id_{1};
+  char pad3_[TD_CONCURRENCY_PAD - sizeof(std::atomic<Id>)];
+};
+
 }  // namespace td
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "td/utils/common.h"
+
+#include <atomic>
+#include <type_traits>
+
+namespace td {
+
+// Chase-Lev work-stealing deque
+// see "Correct and Efficient Work-Stealing for Weak Memory Models" by N.M. Le et al.
+//
+// push and pop may be called only by the owner thread, steal may be called from any thread.
+// T must be a pointer type, nullptr is returned when there is nothing to pop or steal.
+// Old arrays are kept until the deque is destroyed, so thieves never access freed memory.
+template <class T>
+class ChaseLevDeque {
+  static_assert(std::is_pointer<T>::value, "ChaseLevDeque can hold only pointers");
+
+ public:
+  explicit ChaseLevDeque(size_t log_capacity = 8) {
+    auto array = make_unique<Array>(log_capacity);
+    array_.store(array.get(), std::memory_order_relaxed);
+    arrays_.push_back(std::move(array));
+  }
+  ChaseLevDeque(const ChaseLevDeque &other) = delete;
+  ChaseLevDeque &operator=(const ChaseLevDeque &other) = delete;
+  ChaseLevDeque(ChaseLevDeque &&other) = delete;
+  ChaseLevDeque &operator=(ChaseLevDeque &&other) = delete;
+  ~ChaseLevDeque() = default;
+
+  void push(T value) {
+    auto bottom = bottom_.load(std::memory_order_relaxed);
+    auto top = top_.load(std::memory_order_acquire);
+    auto *array = array_.load(std::memory_order_relaxed);
+    if (bottom - top > static_cast<int64>(array->mask())) {
+      array = grow(array, top, bottom);
+    }
+    array->put(bottom, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  T pop() {
+    auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    auto *array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T value = array->get(bottom);
+    if (top == bottom) {
+      // the last element, race with thieves
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        value = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  T steal() {
+    auto top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    auto *array = array_.load(std::memory_order_acquire);
+    T value = array->get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return value;
+  }
+
+  size_t size_unsafe() const {
+    auto size = bottom_.load(std::memory_order_relaxed) - top_.load(std::memory_order_relaxed);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+  }
+
+ private:
+  class Array {
+   public:
+    explicit Array(size_t log_size) : data_(static_cast<size_t>(1) << log_size), log_size_(log_size) {
+    }
+    size_t mask() const {
+      return data_.size() - 1;
+    }
+    size_t log_size() const {
+      return log_size_;
+    }
+    T get(int64 i) const {
+      return data_[static_cast<size_t>(i) & mask()].load(std::memory_order_relaxed);
+    }
+    void put(int64 i, T value) {
+      data_[static_cast<size_t>(i) & mask()].store(value, std::memory_order_relaxed);
+    }
+
+   private:
+    std::vector<std::atomic<T>> data_;
+    size_t log_size_;
+  };
+
+  std::atomic<int64> top_{0};
+  char pad_[TD_CONCURRENCY_PAD - sizeof(std::atomic<int64>)];
+  std::atomic<int64> bottom_{0};
+  std::atomic<Array *> array_{nullptr};
+  char pad2_[TD_CONCURRENCY_PAD - sizeof(std::atomic<int64>) - sizeof(std::atomic<Array *>)];
+  vector<unique_ptr<Array>> arrays_;
+
+  Array *grow(Array *array, int64 top, int64 bottom) {
+    auto new_array = make_unique<Array>(array->log_size() + 1);
+    for (auto i = top; i < bottom; i++) {
+      new_array->put(i, array->get(i));
+    }
+    auto *result = new_array.get();
+    arrays_.push_back(std::move(new_array));
+    array_.store(result, std::memory_order_release);
+    return result;
+  }
+};
+
+}  // namespace td
@@ -2,8 +2,12 @@
 
 #include "td/utils/common.h"
 #include "td/utils/Random.h"
+#include "td/utils/Span.h"
 
 #include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 namespace td {
@@ -11,8 +15,8 @@ namespace td {
 template <typename KeyType, typename ValueType, typename Compare = std::less<KeyType>>
 class DecTree {
   struct Node {
-    unique_ptr<Node> left_;
-    unique_ptr<Node> right_;
+    Node *left_ = nullptr;
+    Node *right_ = nullptr;
     size_t size_;
     KeyType key_;
     ValueType value_;
@@ -31,141 +35,192 @@ class DecTree {
     Node(KeyType key, ValueType value, uint32 y) : size_(1), key_(std::move(key)), value_(std::move(value)), y_(y) {
     }
   };
-  unique_ptr<Node> root_;
 
-  static unique_ptr<Node> create_node(KeyType key, ValueType value, uint32 y) {
-    return make_unique<Node>(std::move(key), std::move(value), y);
-  }
-
-  static unique_ptr<Node> insert_node(unique_ptr<Node> Tree, KeyType key, ValueType value, uint32 y) {
-    if (Tree == nullptr) {
-      return create_node(std::move(key), std::move(value), y);
+  // Allocates nodes in chunks and reuses memory of removed nodes. Nodes never move, so pointers to values are stable
+  class NodeArena {
+   public:
+    Node *create(KeyType key, ValueType value, uint32 y) {
+      void *ptr;
+      if (free_list_ != nullptr) {
+        ptr = free_list_;
+        free_list_ = free_list_->next;
+      } else {
+        if (chunk_used_ == chunk_size_) {
+          size_t min_chunk_size = MIN_CHUNK_SIZE;
+          size_t max_chunk_size = MAX_CHUNK_SIZE;
+          add_chunk(td::min(td::max(chunk_size_ * 2, min_chunk_size), max_chunk_size));
+        }
+        ptr = &chunks_.back()[chunk_used_++];
+      }
+      return new (ptr) Node(std::move(key), std::move(value), y);
     }
-    if (Tree->y_ < y) {
-      auto P = split_node(std::move(Tree), key);
-      auto T = create_node(std::move(key), std::move(value), y);
-      T->left_ = std::move(P.first);
-      T->right_ = std::move(P.second);
-      T->relax();
-      return T;
+
+    void destroy(Node *node) {
+      node->~Node();
+      auto slot = reinterpret_cast<Slot *>(node);
+      slot->next = free_list_;
+      free_list_ = slot;
     }
-    if (Compare()(key, Tree->key_)) {
-      Tree->left_ = insert_node(std::move(Tree->left_), std::move(key), std::move(value), y);
-    } else if (Compare()(Tree->key_, key)) {
-      Tree->right_ = insert_node(std::move(Tree->right_), std::move(key), std::move(value), y);
-    } else {
-      // ?? assert
+
+    // makes the next count allocations contiguous
+    void reserve(size_t count) {
+      if (chunk_size_ - chunk_used_ < count) {
+        add_chunk(count);
+      }
     }
-    Tree->relax();
-    return Tree;
-  }
 
-  static unique_ptr<Node> remove_node(unique_ptr<Node> Tree, const KeyType &key) {
-    if (Tree == nullptr) {
-      // ?? assert
-      return nullptr;
+    void clear() {
+      chunks_.clear();
+      chunk_used_ = 0;
+      chunk_size_ = 0;
+      free_list_ = nullptr;
     }
-    if (Compare()(key, Tree->key_)) {
-      Tree->left_ = remove_node(std::move(Tree->left_), key);
-    } else if (Compare()(Tree->key_, key)) {
-      Tree->right_ = remove_node(std::move(Tree->right_), key);
-    } else {
-      Tree = merge_node(std::move(Tree->left_), std::move(Tree->right_));
+
+   private:
+    union Slot {
+      Slot *next;
+      typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+    };
+    static constexpr size_t MIN_CHUNK_SIZE = 16;
+    static constexpr size_t MAX_CHUNK_SIZE = 1 << 16;
+
+    vector<std::unique_ptr<Slot[]>> chunks_;
+    size_t chunk_used_ = 0;
+    size_t chunk_size_ = 0;
+    Slot *free_list_ = nullptr;
+
+    void add_chunk(size_t size) {
+      chunks_.push_back(std::make_unique<Slot[]>(size));
+      chunk_used_ = 0;
+      chunk_size_ = size;
     }
-    if (Tree != nullptr) {
-      Tree->relax();
+  };
+
+  Node *root_ = nullptr;
+  NodeArena arena_;
+  vector<Node *> path_;  // is used only inside modifying methods to relax nodes on the changed path
+
+  void relax_path() {
+    for (auto it = path_.rbegin(); it != path_.rend(); ++it) {
+      (*it)->relax();
     }
-    return Tree;
+    path_.clear();
   }
 
-  static ValueType *get_node(unique_ptr<Node> &Tree, const KeyType &key) {
-    if (Tree == nullptr) {
-      return nullptr;
-    }
-    if (Compare()(key, Tree->key_)) {
-      return get_node(Tree->left_, key);
-    } else if (Compare()(Tree->key_, key)) {
-      return get_node(Tree->right_, key);
-    } else {
-      return &Tree->value_;
+  static Node *find_node(Node *tree, const KeyType &key) {
+    while (tree != nullptr) {
+      if (Compare()(key, tree->key_)) {
+        tree = tree->left_;
+      } else if (Compare()(tree->key_, key)) {
+        tree = tree->right_;
+      } else {
+        return tree;
+      }
     }
+    return nullptr;
   }
 
-  static ValueType *get_node_by_idx(unique_ptr<Node> &Tree, size_t idx) {
-    CHECK(Tree != nullptr);
-    auto s = (Tree->left_ != nullptr) ? Tree->left_->size_ : 0;
-    if (idx < s) {
-      return get_node_by_idx(Tree->left_, idx);
-    } else if (idx == s) {
-      return &Tree->value_;
-    } else {
-      return get_node_by_idx(Tree->right_, idx - s - 1);
+  static Node *find_node_by_idx(Node *tree, size_t idx) {
+    while (true) {
+      CHECK(tree != nullptr);
+      auto s = (tree->left_ != nullptr) ? tree->left_->size_ : 0;
+      if (idx < s) {
+        tree = tree->left_;
+      } else if (idx == s) {
+        return tree;
+      } else {
+        idx -= s + 1;
+        tree = tree->right_;
+      }
     }
   }
 
-  static const ValueType *get_node(const unique_ptr<Node> &Tree, const KeyType &key) {
-    if (Tree == nullptr) {
-      return nullptr;
-    }
-    if (Compare()(key, Tree->key_)) {
-      return get_node(Tree->left_, key);
-    } else if (Compare()(Tree->key_, key)) {
-      return get_node(Tree->right_, key);
-    } else {
-      return &Tree->value_;
+  // splits the tree into keys not greater than key and keys greater than key
+  void split_node(Node *tree, const KeyType &key, Node *&left, Node *&right) {
+    Node **left_hook = &left;
+    Node **right_hook = &right;
+    while (tree != nullptr) {
+      path_.push_back(tree);
+      if (Compare()(key, tree->key_)) {
+        *right_hook = tree;
+        right_hook = &tree->left_;
+        tree = tree->left_;
+      } else {
+        *left_hook = tree;
+        left_hook = &tree->right_;
+        tree = tree->right_;
+      }
     }
+    *left_hook = nullptr;
+    *right_hook = nullptr;
   }
 
-  static const ValueType *get_node_by_idx(const unique_ptr<Node> &Tree, size_t idx) {
-    CHECK(Tree != nullptr);
-    auto s = (Tree->left_ != nullptr) ? Tree->left_->size_ : 0;
-    if (idx < s) {
-      return get_node_by_idx(Tree->left_, idx);
-    } else if (idx == s) {
-      return &Tree->value_;
-    } else {
-      return get_node_by_idx(Tree->right_, idx - s - 1);
+  // all keys in left must be less than keys in right
+  Node *merge_node(Node *left, Node *right) {
+    Node *result;
+    Node **hook = &result;
+    while (left != nullptr && right != nullptr) {
+      if (left->y_ < right->y_) {
+        *hook = right;
+        path_.push_back(right);
+        hook = &right->left_;
+        right = right->left_;
+      } else {
+        *hook = left;
+        path_.push_back(left);
+        hook = &left->right_;
+        left = left->right_;
+      }
     }
+    *hook = left != nullptr ? left : right;
+    return result;
   }
 
-  static std::pair<unique_ptr<Node>, unique_ptr<Node>> split_node(unique_ptr<Node> Tree, const KeyType &key) {
-    if (Tree == nullptr) {
-      return {nullptr, nullptr};
-    }
-    if (Compare()(key, Tree->key_)) {
-      auto P = split_node(std::move(Tree->left_), key);
-      Tree->left_ = std::move(P.second);
-      Tree->relax();
-      P.second = std::move(Tree);
-      return P;
-    } else {
-      auto P = split_node(std::move(Tree->right_), key);
-      Tree->right_ = std::move(P.first);
-      Tree->relax();
-      P.first = std::move(Tree);
-      return P;
+  void destroy_nodes() {
+    if (!std::is_trivially_destructible<KeyType>::value || !std::is_trivially_destructible<ValueType>::value) {
+      path_.clear();
+      if (root_ != nullptr) {
+        path_.push_back(root_);
+      }
+      while (!path_.empty()) {
+        auto node = path_.back();
+        path_.pop_back();
+        if (node->left_ != nullptr) {
+          path_.push_back(node->left_);
+        }
+        if (node->right_ != nullptr) {
+          path_.push_back(node->right_);
+        }
+        node->~Node();
+      }
     }
-  }  // namespace td
+    root_ = nullptr;
+    arena_.clear();
+  }
 
-  static unique_ptr<Node> merge_node(unique_ptr<Node> left, unique_ptr<Node> right) {
-    if (left == nullptr) {
-      return right;
-    }
-    if (right == nullptr) {
-      return left;
-    }
-    if (left->y_ < right->y_) {
-      right->left_ = merge_node(std::move(left), std::move(right->left_));
-      right->relax();
-      return right;
-    } else {
-      left->right_ = merge_node(std::move(left->right_), std::move(right));
-      left->relax();
-      return left;
+ public:
+  DecTree() = default;
+  DecTree(const DecTree &) = delete;
+  DecTree &operator=(const DecTree &) = delete;
+  DecTree(DecTree &&other) noexcept
+      : root_(other.root_), arena_(std::move(other.arena_)), path_(std::move(other.path_)) {
+    other.root_ = nullptr;
+    other.arena_.clear();
+  }
+  DecTree &operator=(DecTree &&other) noexcept {
+    if (this != &other) {
+      destroy_nodes();
+      root_ = other.root_;
+      arena_ = std::move(other.arena_);
+      other.root_ = nullptr;
+      other.arena_.clear();
     }
+    return *this;
+  }
+  ~DecTree() {
+    destroy_nodes();
   }
 
- public:
   size_t size() const {
     if (root_ == nullptr) {
       return 0;
@@ -174,33 +229,105 @@ class DecTree {
     }
   }
   void insert(KeyType key, ValueType value) {
-    root_ = insert_node(std::move(root_), std::move(key), std::move(value), td::Random::fast_uint32());
+    auto y = td::Random::fast_uint32();
+    Node **hook = &root_;
+    while (*hook != nullptr && (*hook)->y_ >= y) {
+      auto tree = *hook;
+      if (Compare()(key, tree->key_)) {
+        hook = &tree->left_;
+      } else if (Compare()(tree->key_, key)) {
+        hook = &tree->right_;
+      } else {
+        path_.clear();
+        return;
+      }
+      path_.push_back(tree);
+    }
+    if (find_node(*hook, key) != nullptr) {
+      path_.clear();
+      return;
+    }
+
+    auto node = arena_.create(std::move(key), std::move(value), y);
+    auto parent_path_size = path_.size();
+    split_node(*hook, node->key_, node->left_, node->right_);
+    *hook = node;
+    path_.insert(path_.begin() + parent_path_size, node);
+    relax_path();
   }
   void remove(const KeyType &key) {
-    root_ = remove_node(std::move(root_), key);
+    Node **hook = &root_;
+    while (true) {
+      auto tree = *hook;
+      if (tree == nullptr) {
+        path_.clear();
+        return;
+      }
+      if (Compare()(key, tree->key_)) {
+        hook = &tree->left_;
+      } else if (Compare()(tree->key_, key)) {
+        hook = &tree->right_;
+      } else {
+        break;
+      }
+      path_.push_back(tree);
+    }
+    auto node = *hook;
+    *hook = merge_node(node->left_, node->right_);
+    relax_path();
+    arena_.destroy(node);
+  }
+  // replaces content of the tree with the given items, which must be sorted by key without duplicates, in O(n)
+  void build_from_sorted(Span<std::pair<KeyType, ValueType>> items) {
+    destroy_nodes();
+    arena_.reserve(items.size());
+    // right spine of the tree built so far
+    for (size_t i = 0; i < items.size(); i++) {
+      if (i > 0) {
+        CHECK(Compare()(items[i - 1].first, items[i].first));
+      }
+      auto node = arena_.create(items[i].first, items[i].second, td::Random::fast_uint32());
+      Node *last = nullptr;
+      while (!path_.empty() && path_.back()->y_ < node->y_) {
+        last = path_.back();
+        last->relax();
+        path_.pop_back();
+      }
+      node->left_ = last;
+      if (!path_.empty()) {
+        path_.back()->right_ = node;
+      }
+      path_.push_back(node);
+    }
+    if (!path_.empty()) {
+      root_ = path_[0];
+    }
+    relax_path();
   }
   ValueType *get(const KeyType &key) {
-    return get_node(root_, key);
+    auto node = find_node(root_, key);
+    return node == nullptr ? nullptr : &node->value_;
   }
   ValueType *get_random() {
     if (size() == 0) {
       return nullptr;
     } else {
-      return get_node_by_idx(root_, td::Random::fast_uint32() % size());
+      return &find_node_by_idx(root_, td::Random::fast_uint32() % size())->value_;
     }
   }
   const ValueType *get(const KeyType &key) const {
-    return get_node(root_, key);
+    auto node = find_node(root_, key);
+    return node == nullptr ? nullptr : &node->value_;
   }
   const ValueType *get_random() const {
     if (size() == 0) {
       return nullptr;
     } else {
-      return get_node_by_idx(root_, td::Random::fast_uint32() % size());
+      return &find_node_by_idx(root_, td::Random::fast_uint32() % size())->value_;
     }
   }
   bool exists(const KeyType &key) const {
-    return get_node(root_, key) != nullptr;
+    return find_node(root_, key) != nullptr;
   }
 };
 
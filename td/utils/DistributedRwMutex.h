@@ -0,0 +1,160 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Status.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace td {
+
+// Reader-writer lock for read-mostly data ("big-reader" lock)
+// Every reader increments only a counter in its own slot, chosen by get_thread_id(), so readers on different
+// threads don't share cache lines. Threads not created by td::thread share identifier 0, so they get slots round-robin. A writer raises the writer flag and waits until all reader slots are empty.
+//
+// With prefer_writers, readers don't enter while a writer is waiting, so writers can't starve.
+// Without it, a waiting writer backs off while there are readers inside, so readers are never delayed by waiting writers.
+//
+// Has the same interface as RwMutex. Read lock must be released by the same thread that acquired it.
+class DistributedRwMutex {
+ public:
+  explicit DistributedRwMutex(bool prefer_writers = true) : prefer_writers_(prefer_writers) {
+  }
+  DistributedRwMutex(const DistributedRwMutex &) = delete;
+  DistributedRwMutex &operator=(const DistributedRwMutex &) = delete;
+  // only unlocked mutex can be moved
+  DistributedRwMutex(DistributedRwMutex &&other) : prefer_writers_(other.prefer_writers_) {
+  }
+  DistributedRwMutex &operator=(DistributedRwMutex &&other) {
+    prefer_writers_ = other.prefer_writers_;
+    return *this;
+  }
+  ~DistributedRwMutex() = default;
+
+  struct ReadUnlock {
+    void operator()(DistributedRwMutex *ptr) {
+      ptr->unlock_read_unsafe();
+    }
+  };
+  struct WriteUnlock {
+    void operator()(DistributedRwMutex *ptr) {
+      ptr->unlock_write_unsafe();
+    }
+  };
+
+  using ReadLock = std::unique_ptr<DistributedRwMutex, ReadUnlock>;
+  using WriteLock = std::unique_ptr<DistributedRwMutex, WriteUnlock>;
+
+  Result<ReadLock> lock_read() TD_WARN_UNUSED_RESULT {
+    lock_read_unsafe();
+    return ReadLock(this);
+  }
+
+  Result<WriteLock> lock_write() TD_WARN_UNUSED_RESULT {
+    lock_write_unsafe();
+    return WriteLock(this);
+  }
+
+  void lock_read_unsafe() {
+    auto &slot = get_slot();
+    while (true) {
+      slot.readers.fetch_add(1, std::memory_order_seq_cst);
+      if (!writer_.load(std::memory_order_seq_cst)) {
+        return;
+      }
+      if (!prefer_writers_ && writer_in_.load(std::memory_order_seq_cst) == 0) {
+        // writer is waiting, but hasn't entered yet, so it will back off
+        return;
+      }
+      slot.readers.fetch_sub(1, std::memory_order_release);
+      while (writer_.load(std::memory_order_acquire)) {
+        td::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock_read_unsafe() {
+    get_slot().readers.fetch_sub(1, std::memory_order_release);
+  }
+
+  void lock_write_unsafe() {
+    writer_mutex_.lock();
+    while (true) {
+      writer_.store(true, std::memory_order_seq_cst);
+      if (prefer_writers_) {
+        wait_readers();
+        break;
+      }
+      if (!has_readers()) {
+        writer_in_.store(1, std::memory_order_seq_cst);
+        if (!has_readers()) {
+          break;
+        }
+        writer_in_.store(0, std::memory_order_seq_cst);
+      }
+      writer_.store(false, std::memory_order_seq_cst);
+      td::this_thread::yield();
+    }
+  }
+
+  void unlock_write_unsafe() {
+    writer_in_.store(0, std::memory_order_release);
+    writer_.store(false, std::memory_order_release);
+    writer_mutex_.unlock();
+  }
+
+ private:
+  static constexpr size_t SLOTS_N = 32;
+  struct Slot {
+    std::atomic<uint32> readers{0};
+    char pad[TD_CONCURRENCY_PAD - sizeof(std::atomic<uint32>)];
+  };
+
+  bool prefer_writers_;
+  std::unique_ptr<Slot[]> slots_{new Slot[SLOTS_N]};
+  std::atomic<bool> writer_{false};
+  std::atomic<uint32> writer_in_{0};
+  std::mutex writer_mutex_;
+
+  Slot &get_slot() {
+    auto thread_id = static_cast<uint32>(get_thread_id());
+    if (thread_id == 0) {
+      thread_id = get_foreign_thread_slot();
+    }
+    return slots_[thread_id % SLOTS_N];
+  }
+
+  static uint32 get_foreign_thread_slot() {
+    static std::atomic<uint32> next_slot{0};
+    static TD_THREAD_LOCAL uint32 slot;  // static zero-initialized
+    if (slot == 0) {
+      // 0 means that the slot isn't chosen yet, so slots are numbered from 1
+      slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SLOTS_N + 1;
+    }
+    return slot;
+  }
+
+  bool has_readers() const {
+    for (size_t i = 0; i < SLOTS_N; i++) {
+      if (slots_[i].readers.load(std::memory_order_seq_cst) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // the store to writer_ before the call and the loads of the slots must be seq_cst, the same as fetch_add and the load
+  // of writer_ in lock_read_unsafe, otherwise both the writer and a reader can miss each other and enter together
+  void wait_readers() const {
+    for (size_t i = 0; i < SLOTS_N; i++) {
+      while (slots_[i].readers.load(std::memory_order_seq_cst) != 0) {
+        td::this_thread::yield();
+      }
+    }
+  }
+};
+
+}  // namespace td
@@ -109,7 +109,7 @@ class EpochBasedMemoryReclamation {
     }
 
     void idle() {
-      epoch.store(epoch.load(std::memory_order_relaxed) | 1);
+      epoch.store(epoch.load(std::memory_order_relaxed) | 1, std::memory_order_release);
     }
 
     size_t undeleted() const {
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashTable.h"
+#include "td/utils/Hash.h"
+
+#include <initializer_list>
+#include <new>
+#include <tuple>
+#include <utility>
+
+namespace td {
+
+namespace detail {
+template <class KeyT, class ValueT>
+struct FlatHashMapKeyOf {
+  const KeyT &operator()(const std::pair<const KeyT, ValueT> &value) const {
+    return value.first;
+  }
+  // moves the element to uninitialized memory and destroys the source; the key is moved, because the source is
+  // destroyed right after that
+  static void transfer(std::pair<const KeyT, ValueT> *dst, std::pair<const KeyT, ValueT> *src) {
+    new (dst) std::pair<const KeyT, ValueT>(std::move(const_cast<KeyT &>(src->first)), std::move(src->second));
+    src->~pair();
+  }
+};
+}  // namespace detail
+
+// Flat hash map with the interface of absl::flat_hash_map, used when Abseil is unavailable
+template <class KeyT, class ValueT, class HashT = Hash<KeyT>, class EqT = detail::FlatHashEq>
+class FlatHashMap
+    : public detail::FlatHashTable<std::pair<const KeyT, ValueT>, KeyT, detail::FlatHashMapKeyOf<KeyT, ValueT>, HashT,
+                                   EqT> {
+  using Table =
+      detail::FlatHashTable<std::pair<const KeyT, ValueT>, KeyT, detail::FlatHashMapKeyOf<KeyT, ValueT>, HashT, EqT>;
+
+ public:
+  using mapped_type = ValueT;
+  using typename Table::iterator;
+  using typename Table::value_type;
+
+  FlatHashMap() = default;
+  FlatHashMap(std::initializer_list<value_type> values) {
+    this->reserve(values.size());
+    this->insert(values.begin(), values.end());
+  }
+  template <class It>
+  FlatHashMap(It first, It last) {
+    this->insert(first, last);
+  }
+
+  template <class... ArgsT>
+  std::pair<iterator, bool> try_emplace(const KeyT &key, ArgsT &&... args) {
+    return this->emplace_impl(key, std::piecewise_construct, std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::forward<ArgsT>(args)...));
+  }
+  template <class... ArgsT>
+  std::pair<iterator, bool> try_emplace(KeyT &&key, ArgsT &&... args) {
+    return this->emplace_impl(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                              std::forward_as_tuple(std::forward<ArgsT>(args)...));
+  }
+  template <class... ArgsT>
+  std::pair<iterator, bool> emplace(ArgsT &&... args) {
+    return Table::emplace(std::forward<ArgsT>(args)...);
+  }
+  template <class V>
+  std::pair<iterator, bool> emplace(const KeyT &key, V &&value) {
+    return try_emplace(key, std::forward<V>(value));
+  }
+  template <class V>
+  std::pair<iterator, bool> emplace(KeyT &&key, V &&value) {
+    return try_emplace(std::move(key), std::forward<V>(value));
+  }
+
+  template <class V>
+  std::pair<iterator, bool> insert_or_assign(const KeyT &key, V &&value) {
+    auto result = try_emplace(key, std::forward<V>(value));
+    if (!result.second) {
+      result.first->second = std::forward<V>(value);
+    }
+    return result;
+  }
+
+  ValueT &operator[](const KeyT &key) {
+    return try_emplace(key).first->second;
+  }
+  ValueT &operator[](KeyT &&key) {
+    return try_emplace(std::move(key)).first->second;
+  }
+
+  template <class K>
+  ValueT &at(const K &key) {
+    auto it = this->find(key);
+    CHECK(it != this->end());
+    return it->second;
+  }
+  template <class K>
+  const ValueT &at(const K &key) const {
+    auto it = this->find(key);
+    CHECK(it != this->end());
+    return it->second;
+  }
+};
+
+}  // namespace td
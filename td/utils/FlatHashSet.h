@@ -0,0 +1,45 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/FlatHashTable.h"
+#include "td/utils/Hash.h"
+
+#include <initializer_list>
+#include <new>
+#include <utility>
+
+namespace td {
+
+namespace detail {
+template <class KeyT>
+struct FlatHashSetKeyOf {
+  const KeyT &operator()(const KeyT &key) const {
+    return key;
+  }
+  static void transfer(KeyT *dst, KeyT *src) {
+    new (dst) KeyT(std::move(*src));
+    src->~KeyT();
+  }
+};
+}  // namespace detail
+
+// Flat hash set with the interface of absl::flat_hash_set, used when Abseil is unavailable
+template <class KeyT, class HashT = Hash<KeyT>, class EqT = detail::FlatHashEq>
+class FlatHashSet : public detail::FlatHashTable<KeyT, KeyT, detail::FlatHashSetKeyOf<KeyT>, HashT, EqT> {
+  using Table = detail::FlatHashTable<KeyT, KeyT, detail::FlatHashSetKeyOf<KeyT>, HashT, EqT>;
+
+ public:
+  using typename Table::value_type;
+
+  FlatHashSet() = default;
+  FlatHashSet(std::initializer_list<value_type> values) {
+    this->reserve(values.size());
+    this->insert(values.begin(), values.end());
+  }
+  template <class It>
+  FlatHashSet(It first, It last) {
+    this->insert(first, last);
+  }
+};
+
+}  // namespace td
@@ -0,0 +1,530 @@
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TD_FLAT_HASH_TABLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace td {
+namespace detail {
+
+// Control byte of a slot: H2 part of the hash for full slots, or one of the special values with the sign bit set
+enum : int8 { FlatHashCtrlEmpty = -128, FlatHashCtrlDeleted = -2 };
+
+// A group of consecutive control bytes, which are matched at once
+#if TD_FLAT_HASH_TABLE_SSE2
+class FlatHashGroup {
+ public:
+  static constexpr size_t WIDTH = 16;
+
+  explicit FlatHashGroup(const int8 *ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {
+  }
+
+  // bit i is set if i-th byte of the group is equal to h2
+  uint32 match(int8 h2) const {
+    return static_cast<uint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+  }
+  uint32 match_empty() const {
+    return match(FlatHashCtrlEmpty);
+  }
+  uint32 match_empty_or_deleted() const {
+    return static_cast<uint32>(_mm_movemask_epi8(ctrl_));
+  }
+
+ private:
+  __m128i ctrl_;
+};
+#else
+class FlatHashGroup {
+ public:
+  static constexpr size_t WIDTH = 8;
+
+  explicit FlatHashGroup(const int8 *ctrl) {
+    std::memcpy(ctrl_, ctrl, WIDTH);
+  }
+
+  uint32 match(int8 h2) const {
+    uint32 result = 0;
+    for (size_t i = 0; i < WIDTH; i++) {
+      result |= static_cast<uint32>(ctrl_[i] == h2) << i;
+    }
+    return result;
+  }
+  uint32 match_empty() const {
+    return match(FlatHashCtrlEmpty);
+  }
+  uint32 match_empty_or_deleted() const {
+    uint32 result = 0;
+    for (size_t i = 0; i < WIDTH; i++) {
+      result |= static_cast<uint32>(ctrl_[i] < 0) << i;
+    }
+    return result;
+  }
+
+ private:
+  int8 ctrl_[WIDTH];
+};
+#endif
+
+// Open addressing hash table with SwissTable-like layout
+// Slots are stored inline in one array, and for every slot there is a control byte, which is either empty, deleted,
+// or contains 7 bits of the element hash. Lookup probes whole groups of control bytes at once, so only slots with
+// matching 7 hash bits are compared. Erased elements leave tombstones, which are dropped by the next rehash.
+//
+// Capacity is a power of two not less than the group width. The first group of control bytes is cloned after
+// the last one, so a group can be loaded from any position without wrapping around.
+//
+// Lookup functions accept any key, which can be hashed and compared with the stored keys, for example Slice for
+// string keys, as long as the hash of the key is equal to the hash of the equal stored key.
+// Insertion and rehash invalidate iterators; erase invalidates only iterators to the erased element.
+template <class ValueT, class KeyT, class KeyOfValueT, class HashT, class EqT>
+class FlatHashTable {
+  using Storage = typename std::aligned_storage<sizeof(ValueT), alignof(ValueT)>::type;
+
+ public:
+  using key_type = KeyT;
+  using value_type = ValueT;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using hasher = HashT;
+  using key_equal = EqT;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+
+  template <bool IsConst>
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename FlatHashTable::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::conditional_t<IsConst, const value_type &, value_type &>;
+    using pointer = std::conditional_t<IsConst, const value_type *, value_type *>;
+
+    Iterator() = default;
+    // iterator is convertible to const_iterator
+    template <bool WasConst, class = std::enable_if_t<IsConst && !WasConst>>
+    Iterator(const Iterator<WasConst> &other) : table_(other.table_), pos_(other.pos_) {
+    }
+
+    reference operator*() const {
+      return table_->slot(pos_);
+    }
+    pointer operator->() const {
+      return &table_->slot(pos_);
+    }
+    Iterator &operator++() {
+      pos_ = table_->next_full(pos_ + 1);
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+    bool operator==(const Iterator &other) const {
+      return pos_ == other.pos_;
+    }
+    bool operator!=(const Iterator &other) const {
+      return pos_ != other.pos_;
+    }
+
+   private:
+    friend class FlatHashTable;
+    template <bool>
+    friend class Iterator;
+
+    using TablePtr = std::conditional_t<IsConst, const FlatHashTable *, FlatHashTable *>;
+    TablePtr table_ = nullptr;
+    size_t pos_ = 0;
+
+    Iterator(TablePtr table, size_t pos) : table_(table), pos_(pos) {
+    }
+  };
+  using iterator = Iterator<std::is_same<KeyT, ValueT>::value>;  // elements of a set can't be changed
+  using const_iterator = Iterator<true>;
+
+  FlatHashTable() = default;
+  FlatHashTable(const FlatHashTable &other) : hash_(other.hash_), eq_(other.eq_) {
+    reserve(other.size());
+    for (auto &value : other) {
+      insert_unique(value);
+    }
+  }
+  FlatHashTable &operator=(const FlatHashTable &other) {
+    if (this != &other) {
+      FlatHashTable copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+  FlatHashTable(FlatHashTable &&other) noexcept {
+    swap(other);
+  }
+  FlatHashTable &operator=(FlatHashTable &&other) noexcept {
+    if (this != &other) {
+      clear_and_free();
+      swap(other);
+    }
+    return *this;
+  }
+  ~FlatHashTable() {
+    clear_and_free();
+  }
+
+  iterator begin() {
+    return iterator(this, next_full(0));
+  }
+  iterator end() {
+    return iterator(this, capacity_);
+  }
+  const_iterator begin() const {
+    return const_iterator(this, next_full(0));
+  }
+  const_iterator end() const {
+    return const_iterator(this, capacity_);
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  const_iterator cend() const {
+    return end();
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_t size() const {
+    return size_;
+  }
+  size_t capacity() const {
+    return capacity_;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < capacity_; i++) {
+      if (is_full(ctrl_[i])) {
+        slot(i).~ValueT();
+      }
+    }
+    if (capacity_ != 0) {
+      std::memset(ctrl_.get(), FlatHashCtrlEmpty, capacity_ + FlatHashGroup::WIDTH);
+    }
+    size_ = 0;
+    growth_left_ = max_size_for_capacity(capacity_);
+  }
+
+  // ensures that n elements can be stored without rehash
+  void reserve(size_t n) {
+    auto new_capacity = capacity_for_size(n);
+    if (new_capacity > capacity_) {
+      rehash(new_capacity);
+    }
+  }
+
+  template <class K>
+  iterator find(const K &key) {
+    return iterator(this, find_pos(key));
+  }
+  template <class K>
+  const_iterator find(const K &key) const {
+    return const_iterator(this, find_pos(key));
+  }
+  template <class K>
+  size_t count(const K &key) const {
+    return find_pos(key) == capacity_ ? 0 : 1;
+  }
+  template <class K>
+  bool contains(const K &key) const {
+    return find_pos(key) != capacity_;
+  }
+
+  std::pair<iterator, bool> insert(const value_type &value) {
+    return emplace_impl(KeyOfValueT()(value), value);
+  }
+  std::pair<iterator, bool> insert(value_type &&value) {
+    return emplace_impl(KeyOfValueT()(value), std::move(value));
+  }
+  template <class It>
+  void insert(It first, It last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+  template <class... ArgsT>
+  std::pair<iterator, bool> emplace(ArgsT &&... args) {
+    value_type value(std::forward<ArgsT>(args)...);
+    return insert(std::move(value));
+  }
+
+  void erase(const_iterator it) {
+    erase_pos(it.pos_);
+  }
+  template <class K, class = std::enable_if_t<!std::is_convertible<K, const_iterator>::value>>
+  size_t erase(const K &key) {
+    auto pos = find_pos(key);
+    if (pos == capacity_) {
+      return 0;
+    }
+    erase_pos(pos);
+    return 1;
+  }
+
+  void swap(FlatHashTable &other) noexcept {
+    using std::swap;
+    swap(ctrl_, other.ctrl_);
+    swap(slots_, other.slots_);
+    swap(capacity_, other.capacity_);
+    swap(size_, other.size_);
+    swap(growth_left_, other.growth_left_);
+    swap(hash_, other.hash_);
+    swap(eq_, other.eq_);
+  }
+
+  hasher hash_function() const {
+    return hash_;
+  }
+  key_equal key_eq() const {
+    return eq_;
+  }
+
+ protected:
+  // finds the key or inserts a new element constructed from args
+  template <class K, class... ArgsT>
+  std::pair<iterator, bool> emplace_impl(const K &key, ArgsT &&... args) {
+    auto hash = calc_hash(key);
+    auto pos = find_pos(key, hash);
+    if (pos != capacity_) {
+      return {iterator(this, pos), false};
+    }
+    pos = prepare_insert(hash);
+    new (&slot(pos)) ValueT(std::forward<ArgsT>(args)...);
+    return {iterator(this, pos), true};
+  }
+
+ private:
+  std::unique_ptr<int8[]> ctrl_;
+  std::unique_ptr<Storage[]> slots_;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t growth_left_ = 0;
+  HashT hash_;
+  EqT eq_;
+
+  static bool is_full(int8 ctrl) {
+    return ctrl >= 0;
+  }
+
+  // maximum load factor is 7/8
+  static size_t max_size_for_capacity(size_t capacity) {
+    return capacity - capacity / 8;
+  }
+  static size_t capacity_for_size(size_t size) {
+    if (size == 0) {
+      return 0;
+    }
+    size_t capacity = FlatHashGroup::WIDTH;
+    while (max_size_for_capacity(capacity) < size) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  ValueT &slot(size_t pos) {
+    return *reinterpret_cast<ValueT *>(&slots_[pos]);
+  }
+  const ValueT &slot(size_t pos) const {
+    return *reinterpret_cast<const ValueT *>(&slots_[pos]);
+  }
+
+  template <class K>
+  uint64 calc_hash(const K &key) const {
+    // the hash can be weak, for example identity for integers, so its bits must be mixed before splitting
+    auto hash = static_cast<uint64>(hash_(key)) * 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+  }
+  static int8 get_h2(uint64 hash) {
+    return static_cast<int8>(hash & 0x7F);
+  }
+  size_t get_h1_pos(uint64 hash) const {
+    return static_cast<size_t>(hash >> 7) & (capacity_ - 1);
+  }
+
+  void set_ctrl(size_t pos, int8 ctrl) {
+    ctrl_[pos] = ctrl;
+    if (pos < FlatHashGroup::WIDTH) {
+      ctrl_[capacity_ + pos] = ctrl;
+    }
+  }
+
+  size_t next_full(size_t pos) const {
+    while (pos < capacity_ && !is_full(ctrl_[pos])) {
+      pos++;
+    }
+    return pos;
+  }
+
+  template <class K>
+  size_t find_pos(const K &key) const {
+    if (size_ == 0) {
+      return capacity_;
+    }
+    return find_pos(key, calc_hash(key));
+  }
+
+  // groups are probed with triangular steps, which visit every group, because number of groups is a power of two
+  template <class K>
+  size_t find_pos(const K &key, uint64 hash) const {
+    if (capacity_ == 0) {
+      return capacity_;
+    }
+    auto mask = capacity_ - 1;
+    auto h2 = get_h2(hash);
+    auto pos = get_h1_pos(hash);
+    size_t step = 0;
+    while (true) {
+      FlatHashGroup group(&ctrl_[pos]);
+      for (auto bits = group.match(h2); bits != 0; bits &= bits - 1) {
+        auto i = (pos + count_trailing_zeroes_non_zero32(bits)) & mask;
+        if (eq_(KeyOfValueT()(slot(i)), key)) {
+          return i;
+        }
+      }
+      if (group.match_empty() != 0) {
+        return capacity_;
+      }
+      step += FlatHashGroup::WIDTH;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  size_t find_first_non_full(uint64 hash) const {
+    auto mask = capacity_ - 1;
+    auto pos = get_h1_pos(hash);
+    size_t step = 0;
+    while (true) {
+      auto bits = FlatHashGroup(&ctrl_[pos]).match_empty_or_deleted();
+      if (bits != 0) {
+        return (pos + count_trailing_zeroes_non_zero32(bits)) & mask;
+      }
+      step += FlatHashGroup::WIDTH;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  // returns position of a new element, which must be constructed by the caller
+  size_t prepare_insert(uint64 hash) {
+    auto pos = capacity_ == 0 ? 0 : find_first_non_full(hash);
+    if (growth_left_ == 0 && (capacity_ == 0 || ctrl_[pos] != FlatHashCtrlDeleted)) {
+      if (capacity_ != 0 && size_ * 32 <= capacity_ * 25) {
+        // there are many tombstones, so just drop them
+        rehash(capacity_);
+      } else {
+        rehash(capacity_ == 0 ? FlatHashGroup::WIDTH : capacity_ * 2);
+      }
+      pos = find_first_non_full(hash);
+    }
+    if (ctrl_[pos] == FlatHashCtrlEmpty) {
+      growth_left_--;
+    }
+    set_ctrl(pos, get_h2(hash));
+    size_++;
+    return pos;
+  }
+
+  void erase_pos(size_t pos) {
+    slot(pos).~ValueT();
+    size_--;
+    // if there is an empty slot in the same group, no probe sequence could have passed through the slot
+    auto mask = capacity_ - 1;
+    auto empty_after = FlatHashGroup(&ctrl_[pos]).match_empty();
+    auto empty_before = FlatHashGroup(&ctrl_[(pos - FlatHashGroup::WIDTH) & mask]).match_empty();
+    if (empty_after != 0 && empty_before != 0 &&
+        count_trailing_zeroes_non_zero32(empty_after) + count_leading_zeroes_non_zero32(empty_before) <
+            static_cast<int32>(32)) {
+      set_ctrl(pos, FlatHashCtrlEmpty);
+      growth_left_++;
+    } else {
+      set_ctrl(pos, FlatHashCtrlDeleted);
+    }
+  }
+
+  // moves all elements to new arrays of the given capacity, dropping tombstones
+  void rehash(size_t new_capacity) {
+    CHECK(new_capacity >= FlatHashGroup::WIDTH && (new_capacity & (new_capacity - 1)) == 0);
+    auto old_ctrl = std::move(ctrl_);
+    auto old_slots = std::move(slots_);
+    auto old_capacity = capacity_;
+
+    ctrl_ = std::make_unique<int8[]>(new_capacity + FlatHashGroup::WIDTH);
+    std::memset(ctrl_.get(), FlatHashCtrlEmpty, new_capacity + FlatHashGroup::WIDTH);
+    slots_ = std::make_unique<Storage[]>(new_capacity);
+    capacity_ = new_capacity;
+    growth_left_ = max_size_for_capacity(new_capacity) - size_;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+      if (is_full(old_ctrl[i])) {
+        auto &old_value = *reinterpret_cast<ValueT *>(&old_slots[i]);
+        auto hash = calc_hash(KeyOfValueT()(old_value));
+        auto pos = find_first_non_full(hash);
+        set_ctrl(pos, get_h2(hash));
+        KeyOfValueT::transfer(&slot(pos), &old_value);
+      }
+    }
+  }
+
+  void insert_unique(const value_type &value) {
+    auto pos = prepare_insert(calc_hash(KeyOfValueT()(value)));
+    new (&slot(pos)) ValueT(value);
+  }
+
+  void clear_and_free() {
+    clear();
+    ctrl_.reset();
+    slots_.reset();
+    capacity_ = 0;
+    growth_left_ = 0;
+  }
+};
+
+template <class ValueT, class KeyT, class KeyOfValueT, class HashT, class EqT>
+bool operator==(const FlatHashTable<ValueT, KeyT, KeyOfValueT, HashT, EqT> &lhs,
+                const FlatHashTable<ValueT, KeyT, KeyOfValueT, HashT, EqT> &rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (auto &value : lhs) {
+    auto it = rhs.find(KeyOfValueT()(value));
+    if (it == rhs.end() || !(*it == value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class ValueT, class KeyT, class KeyOfValueT, class HashT, class EqT>
+bool operator!=(const FlatHashTable<ValueT, KeyT, KeyOfValueT, HashT, EqT> &lhs,
+                const FlatHashTable<ValueT, KeyT, KeyOfValueT, HashT, EqT> &rhs) {
+  return !(lhs == rhs);
+}
+
+// Compares stored keys with keys of any type, for which operator== is defined
+struct FlatHashEq {
+  template <class A, class B>
+  bool operator()(const A &a, const B &b) const {
+    return a == b;
+  }
+};
+
+}  // namespace detail
+}  // namespace td
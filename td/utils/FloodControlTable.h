@@ -0,0 +1,168 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/Hash.h"
+#include "td/utils/HashMap.h"
+#include "td/utils/SpinLock.h"
+
+#include <array>
+#include <memory>
+
+namespace td {
+
+// Flood control for a big number of keys, for example, for IP addresses or user identifiers.
+// Limits are shared by all keys. For each limit the key stores only theoretical arrival time of GCRA,
+// which is equivalent to a token bucket with capacity of count events refilled by one event each duration / count.
+// Keys without recent events are deleted lazily. Keys are distributed between independently locked shards,
+// so the table can be used from different threads simultaneously.
+template <class KeyT, size_t MaxLimitCount = 2>
+class FloodControlTable {
+ public:
+  explicit FloodControlTable(size_t shard_count = 1) {
+    while (shard_count_ < shard_count) {
+      shard_count_ *= 2;
+    }
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+  }
+
+  // no more than count events in each duration on average, with bursts of up to count events
+  // must be called before the first event is added
+  void add_limit(int32 duration, int32 count) {
+    CHECK(duration > 0 && count > 0);
+    CHECK(limit_count_ < MaxLimitCount);
+    auto full_duration = static_cast<int64>(duration) << TIME_SHIFT;
+    auto interval = full_duration / count;
+    limits_[limit_count_++] = Limit{interval, full_duration - interval};
+    max_duration_ = td::max(max_duration_, duration);
+  }
+
+  // adds the event even if it exceeds the limits; returns time, before which the key must not have new events
+  int32 add_event(const KeyT &key, int32 now) {
+    auto &shard = get_shard(key);
+    auto lock = shard.lock.lock();
+    auto &entry = get_entry(shard, key, now);
+    auto now_time = to_time(now);
+    for (size_t i = 0; i < limit_count_; i++) {
+      entry.arrival_times_[i] = td::max(entry.arrival_times_[i], now_time) + limits_[i].interval_;
+    }
+    return calc_wakeup_at(entry);
+  }
+
+  // adds the event only if it doesn't exceed the limits; returns whether the event was added
+  bool try_add_event(const KeyT &key, int32 now) {
+    auto &shard = get_shard(key);
+    auto lock = shard.lock.lock();
+    auto &entry = get_entry(shard, key, now);
+    if (calc_wakeup_at(entry) > now) {
+      return false;
+    }
+    auto now_time = to_time(now);
+    for (size_t i = 0; i < limit_count_; i++) {
+      entry.arrival_times_[i] = td::max(entry.arrival_times_[i], now_time) + limits_[i].interval_;
+    }
+    return true;
+  }
+
+  // returns time, before which the key must not have new events
+  int32 get_wakeup_at(const KeyT &key) {
+    auto &shard = get_shard(key);
+    auto lock = shard.lock.lock();
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) {
+      return 0;
+    }
+    return calc_wakeup_at(it->second);
+  }
+
+  void clear_events(const KeyT &key) {
+    auto &shard = get_shard(key);
+    auto lock = shard.lock.lock();
+    shard.entries.erase(key);
+  }
+
+  // returns number of stored keys, including keys which aren't deleted yet
+  size_t size() {
+    size_t result = 0;
+    for (size_t i = 0; i < shard_count_; i++) {
+      auto lock = shards_[i].lock.lock();
+      result += shards_[i].entries.size();
+    }
+    return result;
+  }
+
+ private:
+  static constexpr int TIME_SHIFT = 16;  // times are stored as fixed-point numbers to support fractional intervals
+  static constexpr size_t MIN_GC_SIZE = 1024;
+
+  struct Limit {
+    int64 interval_;
+    int64 burst_;
+  };
+  struct Entry {
+    std::array<int64, MaxLimitCount> arrival_times_{};
+  };
+  struct Shard {
+    SpinLock lock;
+    int32 next_gc_at = 0;
+    size_t next_gc_size = MIN_GC_SIZE;
+    HashMap<KeyT, Entry> entries;
+    char pad[TD_CONCURRENCY_PAD];
+  };
+
+  std::array<Limit, MaxLimitCount> limits_{};
+  size_t limit_count_ = 0;
+  int32 max_duration_ = 0;
+  size_t shard_count_ = 1;
+  std::unique_ptr<Shard[]> shards_;
+
+  static int64 to_time(int32 now) {
+    return static_cast<int64>(now) << TIME_SHIFT;
+  }
+
+  Shard &get_shard(const KeyT &key) {
+    // the table uses lower bits of the hash, so the shard is chosen by the higher bits of the mixed hash
+    auto hash = static_cast<uint64>(Hash<KeyT>()(key)) * 0x9E3779B97F4A7C15ULL;
+    return shards_[static_cast<size_t>(hash >> 40) & (shard_count_ - 1)];
+  }
+
+  int32 calc_wakeup_at(const Entry &entry) const {
+    int64 wakeup_time = 0;
+    for (size_t i = 0; i < limit_count_; i++) {
+      wakeup_time = td::max(wakeup_time, entry.arrival_times_[i] - limits_[i].burst_);
+    }
+    return static_cast<int32>((wakeup_time + (static_cast<int64>(1) << TIME_SHIFT) - 1) >> TIME_SHIFT);
+  }
+
+  bool is_idle(const Entry &entry, int64 now_time) const {
+    for (size_t i = 0; i < limit_count_; i++) {
+      if (entry.arrival_times_[i] > now_time) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Entry &get_entry(Shard &shard, const KeyT &key, int32 now) {
+    if (now >= shard.next_gc_at || shard.entries.size() >= shard.next_gc_size) {
+      delete_idle_entries(shard, now);
+    }
+    return shard.entries[key];
+  }
+
+  // idle entries are equivalent to absent, so they can be deleted
+  // the deletion is done at most once in max_duration_ and when the number of entries doubles, so it is amortized O(1)
+  void delete_idle_entries(Shard &shard, int32 now) {
+    auto now_time = to_time(now);
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+      if (is_idle(it->second, now_time)) {
+        shard.entries.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    shard.next_gc_at = now + max_duration_;
+    shard.next_gc_size = td::max(shard.entries.size() * 2, static_cast<size_t>(MIN_GC_SIZE));
+  }
+};
+
+}  // namespace td
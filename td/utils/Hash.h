@@ -1,39 +1,174 @@
 #pragma once
 
 #include "td/utils/common.h"
+#include "td/utils/Slice.h"
 
 #if TD_HAVE_ABSL
 #include <absl/hash/hash.h>
 #endif
 
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#if TD_MSVC && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 namespace td {
 // A simple wrapper for absl::flat_hash_map, std::unordered_map and probably some our implementaion of hash map in
 // the future
 
-// We will introduce out own Hashing utility like an absl one.
+namespace detail {
+// returns xor of the low and the high halves of the 128-bit product
+inline uint64 hash_fold_mul(uint64 a, uint64 b) {
+#if TD_HAVE_INT128
+  auto product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64>(product) ^ static_cast<uint64>(product >> 64);
+#elif TD_MSVC && defined(_M_X64)
+  uint64 hi;
+  uint64 lo = _umul128(a, b, &hi);
+  return lo ^ hi;
+#else
+  uint64 a_lo = a & 0xffffffff;
+  uint64 a_hi = a >> 32;
+  uint64 b_lo = b & 0xffffffff;
+  uint64 b_hi = b >> 32;
+  uint64 lo_lo = a_lo * b_lo;
+  uint64 hi_lo = a_hi * b_lo;
+  uint64 lo_hi = a_lo * b_hi;
+  uint64 hi_hi = a_hi * b_hi;
+  uint64 cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  uint64 hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  uint64 lo = (cross << 32) | (lo_lo & 0xffffffff);
+  return lo ^ hi;
+#endif
+}
+
+inline uint64 hash_read8(const char *ptr) {
+  uint64 result;
+  std::memcpy(&result, ptr, 8);
+  return result;
+}
+
+inline uint64 hash_read4(const char *ptr) {
+  uint32 result;
+  std::memcpy(&result, ptr, 4);
+  return result;
+}
+
+// wyhash-like hash of a byte string; doesn't depend on the string alignment, but depends on the platform endianness
+inline uint64 hash_bytes(const char *ptr, size_t size, uint64 seed) {
+  constexpr uint64 S0 = 0xa0761d6478bd642full;
+  constexpr uint64 S1 = 0xe7037ed1a0b428dbull;
+  constexpr uint64 S2 = 0x8ebc6af09c88c6e3ull;
+  constexpr uint64 S3 = 0x589965cc75374cc3ull;
+
+  seed ^= hash_fold_mul(seed ^ S0, S1);
+  uint64 a;
+  uint64 b;
+  if (size <= 16) {
+    if (size >= 4) {
+      auto shift = (size >> 3) << 2;
+      a = (hash_read4(ptr) << 32) | hash_read4(ptr + shift);
+      b = (hash_read4(ptr + size - 4) << 32) | hash_read4(ptr + size - 4 - shift);
+    } else if (size > 0) {
+      auto *p = reinterpret_cast<const unsigned char *>(ptr);
+      a = (static_cast<uint64>(p[0]) << 16) | (static_cast<uint64>(p[size >> 1]) << 8) | p[size - 1];
+      b = 0;
+    } else {
+      a = 0;
+      b = 0;
+    }
+  } else {
+    auto left = size;
+    if (left > 48) {
+      // three independent lanes for long strings
+      auto seed1 = seed;
+      auto seed2 = seed;
+      do {
+        seed = hash_fold_mul(hash_read8(ptr) ^ S1, hash_read8(ptr + 8) ^ seed);
+        seed1 = hash_fold_mul(hash_read8(ptr + 16) ^ S2, hash_read8(ptr + 24) ^ seed1);
+        seed2 = hash_fold_mul(hash_read8(ptr + 32) ^ S3, hash_read8(ptr + 40) ^ seed2);
+        ptr += 48;
+        left -= 48;
+      } while (left > 48);
+      seed ^= seed1 ^ seed2;
+    }
+    while (left > 16) {
+      seed = hash_fold_mul(hash_read8(ptr) ^ S1, hash_read8(ptr + 8) ^ seed);
+      ptr += 16;
+      left -= 16;
+    }
+    a = hash_read8(ptr + left - 16);
+    b = hash_read8(ptr + left - 8);
+  }
+  return hash_fold_mul(S1 ^ static_cast<uint64>(size), hash_fold_mul(a ^ S1, b ^ seed));
+}
+}  // namespace detail
+
+// Hashing state with the interface of absl hash state, so the same AbslHashValue can be used with both of them.
+// Every combined value is mixed into the state with a multiply-fold, so the order of values matters and
+// equal values in different positions don't cancel each other.
 class Hasher {
  public:
   Hasher() = default;
   Hasher(size_t init_value) : hash_(init_value) {
   }
   std::size_t finalize() {
-    return hash_;
+    return static_cast<std::size_t>(hash_);
   }
 
   static Hasher combine(Hasher hasher, size_t value) {
-    hasher.hash_ ^= value;
+    hasher.hash_ = mix(hasher.hash_, value);
+    return hasher;
+  }
+
+  // strings and Slice have the same hash, so a string-keyed table can be searched by Slice
+  static Hasher combine(Hasher hasher, Slice value) {
+    hasher.hash_ = mix(hasher.hash_, detail::hash_bytes(value.data(), value.size(), SEED));
     return hasher;
   }
 
   template <class A, class B>
   static Hasher combine(Hasher hasher, const std::pair<A, B> &value) {
     hasher = AbslHashValue(std::move(hasher), value.first);
-    hasher = AbslHashValue(std::move(hasher), value.first);
+    hasher = AbslHashValue(std::move(hasher), value.second);
     return hasher;
   }
 
+  template <class... ArgsT>
+  static Hasher combine(Hasher hasher, const std::tuple<ArgsT...> &value) {
+    return combine_tuple(std::move(hasher), value, std::index_sequence_for<ArgsT...>());
+  }
+
+  // combines several values at once, like absl hash state does
+  template <class A, class B, class... ArgsT>
+  static Hasher combine(Hasher hasher, const A &a, const B &b, const ArgsT &... args) {
+    return combine_values(AbslHashValue(std::move(hasher), a), b, args...);
+  }
+
  private:
-  std::size_t hash_{0};
+  static constexpr uint64 SEED = 0x243f6a8885a308d3ull;
+  static constexpr uint64 MUL = 0x9ddfea08eb382d69ull;
+  uint64 hash_{0};
+
+  static uint64 mix(uint64 state, uint64 value) {
+    return detail::hash_fold_mul(state + value, MUL);
+  }
+
+  static Hasher combine_values(Hasher hasher) {
+    return hasher;
+  }
+  template <class A, class... ArgsT>
+  static Hasher combine_values(Hasher hasher, const A &a, const ArgsT &... args) {
+    return combine_values(AbslHashValue(std::move(hasher), a), args...);
+  }
+
+  template <class TupleT, size_t... I>
+  static Hasher combine_tuple(Hasher hasher, const TupleT &value, std::index_sequence<I...>) {
+    return combine_values(std::move(hasher), std::get<I>(value)...);
+  }
 };
 
 template <class IgnoreT>
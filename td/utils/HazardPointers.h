@@ -2,8 +2,10 @@
 
 #include "td/utils/common.h"
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <functional>
 #include <memory>
 
 namespace td {
@@ -56,20 +58,17 @@ class HazardPointers {
     std::atomic<T *> &hazard_ptr_;
   };
 
+  // retired pointers are freed in batches; retire without ptr forces a scan of the thread's retired pointers
   void retire(size_t thread_id, T *ptr = nullptr) {
     CHECK(thread_id < threads_.size());
     auto &data = threads_[thread_id];
     if (ptr) {
       data.to_delete.push_back(std::unique_ptr<T, Deleter>(ptr));
-    }
-    for (auto it = data.to_delete.begin(); it != data.to_delete.end();) {
-      if (!is_protected(it->get())) {
-        it->reset();
-        it = data.to_delete.erase(it);
-      } else {
-        ++it;
+      if (data.to_delete.size() < scan_threshold()) {
+        return;
       }
     }
+    scan(data);
   }
 
   // old inteface
@@ -93,9 +92,9 @@ class HazardPointers {
     std::array<std::atomic<T *>, MaxPointersN> hazard;
     char pad[TD_CONCURRENCY_PAD - sizeof(hazard)];
 
-    // stupid gc
     std::vector<std::unique_ptr<T, Deleter>> to_delete;
-    char pad2[TD_CONCURRENCY_PAD - sizeof(to_delete)];
+    std::vector<T *> protected_snapshot;
+    char pad2[TD_CONCURRENCY_PAD - sizeof(to_delete) - sizeof(protected_snapshot)];
   };
   std::vector<ThreadData> threads_;
   char pad2[TD_CONCURRENCY_PAD - sizeof(threads_)];
@@ -115,15 +114,37 @@ class HazardPointers {
     hazard_ptr.store(nullptr, std::memory_order_release);
   }
 
-  bool is_protected(T *ptr) {
+  // at most threads_n * MaxPointersN pointers can be protected, so every scan frees at least a half of retired pointers
+  size_t scan_threshold() const {
+    return 2 * threads_.size() * MaxPointersN;
+  }
+
+  void scan(ThreadData &data) {
+    if (data.to_delete.empty()) {
+      return;
+    }
+
+    auto &snapshot = data.protected_snapshot;
+    snapshot.clear();
     for (auto &thread : threads_) {
       for (auto &hazard_ptr : thread.hazard) {
-        if (hazard_ptr.load() == ptr) {
-          return true;
+        auto *ptr = hazard_ptr.load();
+        if (ptr != nullptr) {
+          snapshot.push_back(ptr);
         }
       }
     }
-    return false;
+    std::sort(snapshot.begin(), snapshot.end(), std::less<T *>());
+
+    size_t left_n = 0;
+    for (auto &ptr : data.to_delete) {
+      if (std::binary_search(snapshot.begin(), snapshot.end(), ptr.get(), std::less<T *>())) {
+        data.to_delete[left_n++] = std::move(ptr);
+      } else {
+        ptr.reset();
+      }
+    }
+    data.to_delete.resize(left_n);
   }
 
   std::atomic<T *> &get_hazard_ptr(size_t thread_id, size_t pos) {
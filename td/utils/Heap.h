@@ -1,6 +1,16 @@
 #pragma once
 
+#include "td/utils/bits.h"
 #include "td/utils/common.h"
+#include "td/utils/Span.h"
+
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TD_HEAP_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace td {
 
@@ -17,23 +27,81 @@ struct HeapNode {
   int pos_ = -1;
 };
 
+namespace detail {
+
+// returns index of the first minimal key among K consecutive keys
+template <class KeyT, int K>
+int heap_min_child_scalar(const KeyT *keys) {
+  int result = 0;
+  for (int i = 1; i < K; i++) {
+    if (keys[i] < keys[result]) {
+      result = i;
+    }
+  }
+  return result;
+}
+
+template <class KeyT, int K>
+struct HeapMinChild {
+  static int get(const KeyT *keys) {
+    return heap_min_child_scalar<KeyT, K>(keys);
+  }
+};
+
+#if TD_HEAP_SSE2
+// returns mask of the keys equal to the minimum, which is empty if the minimum is NaN
+inline uint32 heap_min_mask(__m128d min, const __m128d *values, int count) {
+  min = _mm_min_pd(min, _mm_shuffle_pd(min, min, 1));
+  uint32 mask = 0;
+  for (int i = 0; i < count; i++) {
+    mask |= static_cast<uint32>(_mm_movemask_pd(_mm_cmpeq_pd(values[i], min))) << (2 * i);
+  }
+  return mask;
+}
+
+template <>
+struct HeapMinChild<double, 4> {
+  static int get(const double *keys) {
+    __m128d values[2] = {_mm_loadu_pd(keys), _mm_loadu_pd(keys + 2)};
+    auto mask = heap_min_mask(_mm_min_pd(values[0], values[1]), values, 2);
+    return mask == 0 ? heap_min_child_scalar<double, 4>(keys) : count_trailing_zeroes32(mask);
+  }
+};
+
+template <>
+struct HeapMinChild<double, 8> {
+  static int get(const double *keys) {
+    __m128d values[4] = {_mm_loadu_pd(keys), _mm_loadu_pd(keys + 2), _mm_loadu_pd(keys + 4), _mm_loadu_pd(keys + 6)};
+    auto mask =
+        heap_min_mask(_mm_min_pd(_mm_min_pd(values[0], values[1]), _mm_min_pd(values[2], values[3])), values, 4);
+    return mask == 0 ? heap_min_child_scalar<double, 8>(keys) : count_trailing_zeroes32(mask);
+  }
+};
+#endif
+
+}  // namespace detail
+
+// K-ary min-heap of intrusive HeapNode. Keys are stored in a dense array separately from node pointers,
+// so choosing the minimal child touches only consecutive keys
 template <class KeyT, int K = 4>
 class KHeap {
+  static_assert(K >= 2, "K must be at least 2");
+
  public:
   bool empty() const {
-    return array_.empty();
+    return keys_.empty();
   }
   size_t size() const {
-    return array_.size();
+    return keys_.size();
   }
 
   KeyT top_key() const {
-    return array_[0].key_;
+    return keys_[0];
   }
 
   HeapNode *pop() {
     CHECK(!empty());
-    HeapNode *result = array_[0].node_;
+    HeapNode *result = nodes_[0];
     result->remove();
     erase(0);
     return result;
@@ -41,15 +109,39 @@ class KHeap {
 
   void insert(KeyT key, HeapNode *node) {
     CHECK(!node->in_heap());
-    array_.push_back({key, node});
-    fix_up(static_cast<int>(array_.size()) - 1);
+    keys_.push_back(key);
+    nodes_.push_back(node);
+    fix_up(static_cast<int>(keys_.size()) - 1);
+  }
+
+  // inserts all the items at once; takes O(n) time if the heap is empty or the number of items is big enough
+  void build(Span<std::pair<KeyT, HeapNode *>> items) {
+    auto old_size = keys_.size();
+    if (items.size() < old_size / K) {
+      for (auto &item : items) {
+        insert(item.first, item.second);
+      }
+      return;
+    }
+
+    keys_.reserve(old_size + items.size());
+    nodes_.reserve(old_size + items.size());
+    for (auto &item : items) {
+      CHECK(!item.second->in_heap());
+      item.second->pos_ = static_cast<int>(keys_.size());
+      keys_.push_back(item.first);
+      nodes_.push_back(item.second);
+    }
+    for (auto pos = static_cast<int>(keys_.size() + K - 2) / K - 1; pos >= 0; pos--) {
+      fix_down(pos);
+    }
   }
 
   void fix(KeyT key, HeapNode *node) {
     CHECK(node->in_heap());
     int pos = node->pos_;
-    KeyT old_key = array_[pos].key_;
-    array_[pos].key_ = key;
+    KeyT old_key = keys_[pos];
+    keys_[pos] = key;
     if (key < old_key) {
       fix_up(pos);
     } else {
@@ -66,83 +158,93 @@ class KHeap {
 
   template <class F>
   void for_each(F &&f) const {
-    for (auto &it : array_) {
-      f(it.key_, it.node_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      f(keys_[i], nodes_[i]);
     }
   }
 
   template <class F>
   void for_each(F &&f) {
-    for (auto &it : array_) {
-      f(it.key_, it.node_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      f(keys_[i], nodes_[i]);
     }
   }
 
   void check() const {
-    for (size_t i = 0; i < array_.size(); i++) {
-      for (size_t j = i * K + 1; j < i * K + 1 + K && j < array_.size(); j++) {
-        CHECK(array_[i].key_ <= array_[j].key_);
+    for (size_t i = 0; i < keys_.size(); i++) {
+      CHECK(nodes_[i]->pos_ == static_cast<int>(i));
+      for (size_t j = i * K + 1; j < i * K + 1 + K && j < keys_.size(); j++) {
+        CHECK(keys_[i] <= keys_[j]);
       }
     }
   }
 
  private:
-  struct Item {
-    KeyT key_;
-    HeapNode *node_;
-  };
-  vector<Item> array_;
+  vector<KeyT> keys_;
+  vector<HeapNode *> nodes_;
+
+  void move(int from, int to) {
+    keys_[to] = keys_[from];
+    nodes_[to] = nodes_[from];
+    nodes_[to]->pos_ = to;
+  }
 
   void fix_up(int pos) {
-    auto item = array_[pos];
+    KeyT key = keys_[pos];
+    HeapNode *node = nodes_[pos];
 
     while (pos) {
       int parent_pos = (pos - 1) / K;
-      auto parent_item = array_[parent_pos];
-
-      if (parent_item.key_ < item.key_) {
+      if (keys_[parent_pos] < key) {
         break;
       }
 
-      parent_item.node_->pos_ = pos;
-      array_[pos] = parent_item;
+      move(parent_pos, pos);
       pos = parent_pos;
     }
 
-    item.node_->pos_ = pos;
-    array_[pos] = item;
+    keys_[pos] = key;
+    nodes_[pos] = node;
+    node->pos_ = pos;
   }
 
   void fix_down(int pos) {
-    auto item = array_[pos];
+    KeyT key = keys_[pos];
+    HeapNode *node = nodes_[pos];
+    auto size = static_cast<int>(keys_.size());
     while (true) {
       int left_pos = pos * K + 1;
-      int right_pos = min(left_pos + K, static_cast<int>(array_.size()));
-      int next_pos = pos;
-      KeyT next_key = item.key_;
-      for (int i = left_pos; i < right_pos; i++) {
-        KeyT i_key = array_[i].key_;
-        if (i_key < next_key) {
-          next_key = i_key;
-          next_pos = i;
+      int next_pos;
+      if (left_pos + K <= size) {
+        next_pos = left_pos + detail::HeapMinChild<KeyT, K>::get(&keys_[left_pos]);
+      } else if (left_pos < size) {
+        next_pos = left_pos;
+        for (int i = left_pos + 1; i < size; i++) {
+          if (keys_[i] < keys_[next_pos]) {
+            next_pos = i;
+          }
         }
+      } else {
+        break;
       }
-      if (next_pos == pos) {
+      if (!(keys_[next_pos] < key)) {
         break;
       }
-      array_[pos] = array_[next_pos];
-      array_[pos].node_->pos_ = pos;
+      move(next_pos, pos);
       pos = next_pos;
     }
 
-    item.node_->pos_ = pos;
-    array_[pos] = item;
+    keys_[pos] = key;
+    nodes_[pos] = node;
+    node->pos_ = pos;
   }
 
   void erase(int pos) {
-    array_[pos] = array_.back();
-    array_.pop_back();
-    if (pos < static_cast<int>(array_.size())) {
+    keys_[pos] = keys_.back();
+    nodes_[pos] = nodes_.back();
+    keys_.pop_back();
+    nodes_.pop_back();
+    if (pos < static_cast<int>(keys_.size())) {
       fix_down(pos);
       fix_up(pos);
     }
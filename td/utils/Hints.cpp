@@ -2,12 +2,19 @@
 
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/FileFd.h"
+#include "td/utils/port/path.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/Slice.h"
 #include "td/utils/translit.h"
 #include "td/utils/unicode.h"
 #include "td/utils/utf8.h"
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <numeric>
 
 namespace td {
 
@@ -60,6 +67,323 @@ vector<string> Hints::get_words(Slice name, bool is_search) {
   return fix_words(std::move(words));
 }
 
+static void append_varint(string &str, uint64 value) {
+  while (value >= 0x80) {
+    str += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  str += static_cast<char>(value);
+}
+
+static uint64 read_varint(const unsigned char *&ptr) {
+  uint64 result = 0;
+  int shift = 0;
+  while (*ptr >= 0x80) {
+    result |= static_cast<uint64>(*ptr++ & 0x7f) << shift;
+    shift += 7;
+  }
+  return result | (static_cast<uint64>(*ptr++) << shift);
+}
+
+namespace {
+// all numbers are stored in native byte order, arrays are aligned to 8 bytes to be usable directly from the mapping
+constexpr uint64 HINTS_SNAPSHOT_MAGIC = 0x31746e6968647421;
+constexpr uint64 HINTS_SNAPSHOT_VERSION = 1;
+
+class HintsSnapshotWriter {
+ public:
+  explicit HintsSnapshotWriter(FileFd &fd) : fd_(fd) {
+  }
+
+  void store_uint64(uint64 value) {
+    store_bytes(Slice(reinterpret_cast<const char *>(&value), sizeof(value)));
+  }
+
+  template <class T>
+  void store_array(const T *data, size_t size) {
+    if (size != 0) {
+      store_bytes(Slice(reinterpret_cast<const char *>(data), size * sizeof(T)));
+    }
+    align();
+  }
+
+  void store_bytes(Slice data) {
+    buffer_.append(data.begin(), data.size());
+    size_ += data.size();
+    if (buffer_.size() >= (1 << 20)) {
+      flush();
+    }
+  }
+
+  void align() {
+    static const char zeros[8] = {};
+    if (size_ % 8 != 0) {
+      store_bytes(Slice(zeros, 8 - size_ % 8));
+    }
+  }
+
+  Status finish() TD_WARN_UNUSED_RESULT {
+    flush();
+    return std::move(status_);
+  }
+
+ private:
+  FileFd &fd_;
+  string buffer_;
+  uint64 size_ = 0;
+  Status status_;
+
+  void flush() {
+    Slice data = buffer_;
+    while (status_.is_ok() && !data.empty()) {
+      auto r_size = fd_.write(data);
+      if (r_size.is_error()) {
+        status_ = r_size.move_as_error();
+      } else {
+        data.remove_prefix(r_size.ok());
+      }
+    }
+    buffer_.clear();
+  }
+};
+
+class HintsSnapshotParser {
+ public:
+  explicit HintsSnapshotParser(Slice data) : data_(data) {
+  }
+
+  Result<uint64> fetch_uint64() {
+    TRY_RESULT(bytes, fetch_bytes(sizeof(uint64)));
+    uint64 result;
+    std::memcpy(&result, bytes.data(), sizeof(result));
+    return result;
+  }
+
+  template <class T>
+  Result<Span<T>> fetch_array(uint64 size) {
+    if (size > data_.size() / sizeof(T)) {
+      return Status::Error("Snapshot is truncated");
+    }
+    TRY_RESULT(bytes, fetch_bytes(static_cast<size_t>(size) * sizeof(T)));
+    align();
+    return Span<T>(reinterpret_cast<const T *>(bytes.data()), static_cast<size_t>(size));
+  }
+
+  Result<Slice> fetch_bytes(uint64 size) {
+    if (size > data_.size()) {
+      return Status::Error("Snapshot is truncated");
+    }
+    auto result = data_.substr(0, static_cast<size_t>(size));
+    data_.remove_prefix(static_cast<size_t>(size));
+    offset_ += static_cast<size_t>(size);
+    return result;
+  }
+
+  void align() {
+    auto padding = td::min((8 - offset_ % 8) % 8, data_.size());
+    data_.remove_prefix(padding);
+    offset_ += padding;
+  }
+
+  bool empty() const {
+    return data_.empty();
+  }
+
+ private:
+  Slice data_;
+  size_t offset_ = 0;
+};
+
+// merges sorted runs [0, run_ends[0]), [run_ends[0], run_ends[1]), ... pairwise
+template <class T>
+void merge_sorted_runs(vector<T> &values, vector<size_t> &run_ends) {
+  while (run_ends.size() > 1) {
+    size_t new_run_count = 0;
+    size_t run_begin = 0;
+    for (size_t i = 0; i < run_ends.size(); i += 2) {
+      if (i + 1 < run_ends.size()) {
+        std::inplace_merge(values.begin() + run_begin, values.begin() + run_ends[i], values.begin() + run_ends[i + 1]);
+        run_begin = run_ends[i + 1];
+      } else {
+        run_begin = run_ends[i];
+      }
+      run_ends[new_run_count++] = run_begin;
+    }
+    run_ends.resize(new_run_count);
+  }
+}
+
+template <class T>
+Status check_offsets(Span<T> offsets, size_t data_size, bool is_strict) {
+  if (offsets.empty() || offsets[0] != 0 || offsets[offsets.size() - 1] != data_size) {
+    return Status::Error("Snapshot has wrong offsets");
+  }
+  for (size_t i = 1; i < offsets.size(); i++) {
+    if (offsets[i] < offsets[i - 1] || (is_strict && offsets[i] == offsets[i - 1])) {
+      return Status::Error("Snapshot has wrong offsets");
+    }
+  }
+  return Status::OK();
+}
+}  // namespace
+
+void Hints::CompactWordIndex::append(Slice word, const vector<KeyT> &keys) {
+  CHECK(!keys.empty());
+  if (storage_ == nullptr) {
+    CHECK(word_count() == 0);
+    storage_ = make_unique<Storage>();
+  }
+  CHECK(word_count() == 0 || get_word(word_count() - 1) < word);
+  auto &storage = *storage_;
+  storage.words.append(word.begin(), word.size());
+  CHECK(storage.words.size() <= std::numeric_limits<uint32>::max());
+  storage.word_offsets.push_back(static_cast<uint32>(storage.words.size()));
+
+  // the first key is zigzag-encoded, all other keys are stored as differences with the previous key
+  auto first_key = static_cast<uint64>(keys[0]);
+  append_varint(storage.postings, (first_key << 1) ^ static_cast<uint64>(keys[0] >> 63));
+  for (size_t i = 1; i < keys.size(); i++) {
+    DCHECK(keys[i - 1] < keys[i]);
+    append_varint(storage.postings, static_cast<uint64>(keys[i]) - static_cast<uint64>(keys[i - 1]));
+  }
+  CHECK(storage.postings.size() <= std::numeric_limits<uint32>::max());
+  storage.posting_offsets.push_back(static_cast<uint32>(storage.postings.size()));
+  entry_count_ += keys.size();
+
+  words_ = storage.words;
+  word_offsets_ = storage.word_offsets;
+  postings_ = storage.postings;
+  posting_offsets_ = storage.posting_offsets;
+}
+
+void Hints::CompactWordIndex::get_keys(size_t word_id, vector<KeyT> &keys) const {
+  auto ptr = postings_.ubegin() + posting_offsets_[word_id];
+  auto end = postings_.ubegin() + posting_offsets_[word_id + 1];
+  auto zigzag_key = read_varint(ptr);
+  auto key = static_cast<uint64>(zigzag_key >> 1) ^ (0 - (zigzag_key & 1));
+  keys.push_back(static_cast<KeyT>(key));
+  while (ptr != end) {
+    key += read_varint(ptr);
+    keys.push_back(static_cast<KeyT>(key));
+  }
+}
+
+size_t Hints::CompactWordIndex::lower_bound(Slice prefix) const {
+  size_t left = 0;
+  size_t right = word_count();
+  while (left < right) {
+    auto middle = left + (right - left) / 2;
+    if (get_word(middle) < prefix) {
+      left = middle + 1;
+    } else {
+      right = middle;
+    }
+  }
+  return left;
+}
+
+template <class StorerT>
+void Hints::CompactWordIndex::store(StorerT &storer) const {
+  static const uint32 empty_offsets[1] = {0};
+  storer.store_uint64(entry_count_);
+  storer.store_uint64(word_count());
+  storer.store_uint64(words_.size());
+  storer.store_uint64(postings_.size());
+  if (word_offsets_.empty()) {
+    storer.store_array(empty_offsets, 1);
+    storer.store_array(empty_offsets, 1);
+  } else {
+    storer.store_array(word_offsets_.data(), word_offsets_.size());
+    storer.store_array(posting_offsets_.data(), posting_offsets_.size());
+  }
+  storer.store_array(words_.data(), words_.size());
+  storer.store_array(postings_.data(), postings_.size());
+}
+
+template <class ParserT>
+Status Hints::CompactWordIndex::parse(ParserT &parser) {
+  TRY_RESULT(entry_count, parser.fetch_uint64());
+  TRY_RESULT(word_count, parser.fetch_uint64());
+  TRY_RESULT(words_size, parser.fetch_uint64());
+  TRY_RESULT(postings_size, parser.fetch_uint64());
+  if (word_count >= std::numeric_limits<uint32>::max()) {
+    return Status::Error("Snapshot has too many words");
+  }
+  TRY_RESULT(word_offsets, parser.template fetch_array<uint32>(word_count + 1));
+  TRY_RESULT(posting_offsets, parser.template fetch_array<uint32>(word_count + 1));
+  TRY_RESULT(words, parser.fetch_bytes(words_size));
+  parser.align();
+  TRY_RESULT(postings, parser.fetch_bytes(postings_size));
+  parser.align();
+
+  TRY_STATUS(check_offsets(word_offsets, words.size(), false));
+  TRY_STATUS(check_offsets(posting_offsets, postings.size(), true));
+  for (size_t i = 1; i < posting_offsets.size(); i++) {
+    // the last byte of every list must finish a varint
+    if (postings.ubegin()[posting_offsets[i] - 1] >= 0x80) {
+      return Status::Error("Snapshot has wrong keys");
+    }
+  }
+  size_t varint_size = 0;
+  for (auto c : postings) {
+    // a 64-bit value takes at most 10 bytes
+    varint_size = static_cast<unsigned char>(c) >= 0x80 ? varint_size + 1 : 0;
+    if (varint_size >= 10) {
+      return Status::Error("Snapshot has wrong keys");
+    }
+  }
+  for (size_t i = 1; i < word_count; i++) {
+    auto prev_word = words.substr(word_offsets[i - 1], word_offsets[i] - word_offsets[i - 1]);
+    auto word = words.substr(word_offsets[i], word_offsets[i + 1] - word_offsets[i]);
+    if (!(prev_word < word)) {
+      return Status::Error("Snapshot has unsorted words");
+    }
+  }
+
+  storage_ = nullptr;
+  words_ = words;
+  word_offsets_ = word_offsets;
+  postings_ = postings;
+  posting_offsets_ = posting_offsets;
+  entry_count_ = static_cast<size_t>(entry_count);
+  return Status::OK();
+}
+
+size_t Hints::CompactKeyTable::find(KeyT key) const {
+  auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+  if (it == keys_.end() || *it != key) {
+    return size();
+  }
+  return static_cast<size_t>(it - keys_.begin());
+}
+
+template <class ParserT>
+Status Hints::CompactKeyTable::parse(ParserT &parser) {
+  TRY_RESULT(key_count, parser.fetch_uint64());
+  TRY_RESULT(names_size, parser.fetch_uint64());
+  if (key_count >= std::numeric_limits<uint32>::max()) {
+    return Status::Error("Snapshot has too many keys");
+  }
+  TRY_RESULT(keys, parser.template fetch_array<KeyT>(key_count));
+  TRY_RESULT(ratings, parser.template fetch_array<RatingT>(key_count));
+  TRY_RESULT(name_offsets, parser.template fetch_array<uint64>(key_count + 1));
+  TRY_RESULT(names, parser.fetch_bytes(names_size));
+  parser.align();
+
+  TRY_STATUS(check_offsets(name_offsets, names.size(), true));
+  for (size_t i = 1; i < keys.size(); i++) {
+    if (keys[i - 1] >= keys[i]) {
+      return Status::Error("Snapshot has unsorted keys");
+    }
+  }
+
+  keys_ = keys;
+  ratings_ = ratings;
+  name_offsets_ = name_offsets;
+  names_ = names;
+  return Status::OK();
+}
+
 void Hints::add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys) {
   vector<KeyT> &keys = word_to_keys[word];
   CHECK(std::find(keys.begin(), keys.end(), key) == keys.end());
@@ -79,25 +403,69 @@ void Hints::delete_word(const string &word, KeyT key, std::map<string, vector<Ke
   }
 }
 
-void Hints::add(KeyT key, Slice name) {
-  // LOG(ERROR) << "Add " << key << ": " << name;
+vector<string> Hints::get_transliterations(const vector<string> &words) {
+  vector<string> transliterations;
+  for (auto &word : words) {
+    for (auto &w : get_word_transliterations(word, false)) {
+      if (w != word) {
+        transliterations.push_back(std::move(w));
+      }
+    }
+  }
+  return fix_words(std::move(transliterations));
+}
+
+void Hints::delete_key_words(KeyT key, Slice name) {
+  auto words = get_words(name, false);
+  if (words.empty()) {
+    return;
+  }
+
+  // words of a key are either all in the compact indexes or all in the maps
+  auto it = word_to_keys_.find(words[0]);
+  if (it == word_to_keys_.end() || std::find(it->second.begin(), it->second.end(), key) == it->second.end()) {
+    outdated_compact_keys_.insert(key);
+    return;
+  }
+
+  for (auto &word : words) {
+    delete_word(word, key, word_to_keys_);
+  }
+  for (auto &word : get_transliterations(words)) {
+    delete_word(word, key, translit_word_to_keys_);
+  }
+}
+
+Slice Hints::get_name(KeyT key) const {
   auto it = key_to_name_.find(key);
   if (it != key_to_name_.end()) {
-    if (it->second == name) {
-      return;
+    return it->second;
+  }
+  if (snapshot_keys_.size() != 0 && changed_snapshot_keys_.count(key) == 0) {
+    auto pos = snapshot_keys_.find(key);
+    if (pos != snapshot_keys_.size()) {
+      return snapshot_keys_.get_name(pos);
     }
-    vector<string> old_transliterations;
-    for (auto &old_word : get_words(it->second, false)) {
-      delete_word(old_word, key, word_to_keys_);
+  }
+  return Slice();
+}
 
-      for (auto &w : get_word_transliterations(old_word, false)) {
-        if (w != old_word) {
-          old_transliterations.push_back(std::move(w));
-        }
-      }
+bool Hints::change_name(KeyT key, Slice name) {
+  auto it = key_to_name_.find(key);
+  auto old_name = it != key_to_name_.end() ? Slice(it->second) : get_name(key);
+  bool had_name = !old_name.empty();
+  if (had_name) {
+    if (old_name == name) {
+      return false;
     }
-    for (auto &word : fix_words(old_transliterations)) {
-      delete_word(word, key, translit_word_to_keys_);
+    delete_key_words(key, old_name);
+    if (it == key_to_name_.end()) {
+      // the key is from the snapshot, so its name and rating must be moved to the maps
+      if (!name.empty() && key_to_rating_.count(key) == 0) {
+        auto rating = get_rating(key);
+        key_to_rating_[key] = rating;
+      }
+      changed_snapshot_keys_.insert(key);
     }
   }
   if (name.empty()) {
@@ -105,24 +473,207 @@ void Hints::add(KeyT key, Slice name) {
       key_to_name_.erase(it);
     }
     key_to_rating_.erase(key);
+    return had_name;
+  }
+
+  key_to_name_[key] = name.str();
+  return true;
+}
+
+void Hints::add(KeyT key, Slice name) {
+  // LOG(ERROR) << "Add " << key << ": " << name;
+  if (!change_name(key, name)) {
     return;
   }
+  if (!name.empty()) {
+    auto words = get_words(name, false);
+    for (auto &word : words) {
+      add_word(word, key, word_to_keys_);
+    }
+    for (auto &word : get_transliterations(words)) {
+      add_word(word, key, translit_word_to_keys_);
+    }
+  }
+  on_change();
+}
 
-  vector<string> transliterations;
-  for (auto &word : get_words(name, false)) {
-    add_word(word, key, word_to_keys_);
+void Hints::add_batch(Span<std::pair<KeyT, Slice>> names) {
+  // only the last name of a key matters, but a rating is dropped by any empty name
+  vector<size_t> positions(names.size());
+  std::iota(positions.begin(), positions.end(), static_cast<size_t>(0));
+  std::stable_sort(positions.begin(), positions.end(),
+                   [&names](size_t lhs, size_t rhs) { return names[lhs].first < names[rhs].first; });
+  vector<std::pair<KeyT, Slice>> new_names;
+  for (size_t i = 0; i < positions.size(); i++) {
+    auto key = names[positions[i]].first;
+    bool has_empty_name = names[positions[i]].second.empty();
+    while (i + 1 < positions.size() && names[positions[i + 1]].first == key) {
+      i++;
+      has_empty_name |= names[positions[i]].second.empty();
+    }
+    auto name = names[positions[i]].second;
+    if (has_empty_name && !name.empty() && change_name(key, Slice())) {
+      on_change();
+    }
+    if (change_name(key, name)) {
+      if (name.empty()) {
+        on_change();
+      } else {
+        new_names.emplace_back(key, name);
+      }
+    }
+  }
+  if (new_names.empty()) {
+    return;
+  }
 
-    for (auto &w : get_word_transliterations(word, false)) {
-      if (w != word) {
-        transliterations.push_back(std::move(w));
+  // split names into words in parallel; every thread produces sorted runs of (word, key) pairs
+  size_t thread_count = 1;
+#if !TD_THREAD_UNSUPPORTED
+  thread_count = clamp(static_cast<size_t>(td::thread::hardware_concurrency()), static_cast<size_t>(1),
+                       new_names.size() / MIN_THREAD_NAME_COUNT + 1);
+#endif
+  vector<vector<std::pair<string, KeyT>>> word_runs(thread_count);
+  vector<vector<std::pair<string, KeyT>>> translit_runs(thread_count);
+  auto split_names = [&](size_t thread_id) {
+    auto begin = new_names.size() * thread_id / thread_count;
+    auto end = new_names.size() * (thread_id + 1) / thread_count;
+    auto &word_keys = word_runs[thread_id];
+    auto &translit_word_keys = translit_runs[thread_id];
+    for (auto i = begin; i < end; i++) {
+      auto key = new_names[i].first;
+      auto words = get_words(new_names[i].second, false);
+      for (auto &word : get_transliterations(words)) {
+        translit_word_keys.emplace_back(std::move(word), key);
+      }
+      for (auto &word : words) {
+        word_keys.emplace_back(std::move(word), key);
       }
     }
+    std::sort(word_keys.begin(), word_keys.end());
+    std::sort(translit_word_keys.begin(), translit_word_keys.end());
+  };
+#if !TD_THREAD_UNSUPPORTED
+  vector<td::thread> threads;
+  for (size_t thread_id = 1; thread_id < thread_count; thread_id++) {
+    threads.emplace_back(split_names, thread_id);
   }
-  for (auto &word : fix_words(transliterations)) {
-    add_word(word, key, translit_word_to_keys_);
+  split_names(0);
+  for (auto &thread : threads) {
+    thread.join();
   }
+#else
+  split_names(0);
+#endif
 
-  key_to_name_[key] = name.str();
+  auto merge_runs = [](vector<vector<std::pair<string, KeyT>>> &runs) {
+    vector<std::pair<string, KeyT>> result = std::move(runs[0]);
+    vector<size_t> run_ends{result.size()};
+    for (size_t i = 1; i < runs.size(); i++) {
+      std::move(runs[i].begin(), runs[i].end(), std::back_inserter(result));
+      run_ends.push_back(result.size());
+    }
+    merge_sorted_runs(result, run_ends);
+    return result;
+  };
+  auto word_keys = merge_runs(word_runs);
+  auto translit_word_keys = merge_runs(translit_runs);
+
+  if (new_names.size() < MIN_COMPACTION_CHANGE_COUNT) {
+    for (auto &word_key : word_keys) {
+      add_word(word_key.first, word_key.second, word_to_keys_);
+    }
+    for (auto &word_key : translit_word_keys) {
+      add_word(word_key.first, word_key.second, translit_word_to_keys_);
+    }
+    for (size_t i = 0; i < new_names.size(); i++) {
+      on_change();
+    }
+    return;
+  }
+
+  // merge everything into the compact indexes in one pass
+  compact_word_to_keys_ = compact_index(compact_word_to_keys_, word_to_keys_, outdated_compact_keys_, word_keys);
+  compact_translit_word_to_keys_ =
+      compact_index(compact_translit_word_to_keys_, translit_word_to_keys_, outdated_compact_keys_, translit_word_keys);
+  word_to_keys_.clear();
+  translit_word_to_keys_.clear();
+  outdated_compact_keys_.clear();
+  change_count_ = 0;
+}
+
+void Hints::on_change() {
+  change_count_++;
+  auto compact_entry_count = compact_word_to_keys_.entry_count() + compact_translit_word_to_keys_.entry_count();
+  size_t min_change_count = MIN_COMPACTION_CHANGE_COUNT;
+  if (change_count_ >= td::max(min_change_count, compact_entry_count / 4)) {
+    compact();
+  }
+}
+
+void Hints::compact() {
+  compact_word_to_keys_ = compact_index(compact_word_to_keys_, word_to_keys_, outdated_compact_keys_, {});
+  compact_translit_word_to_keys_ =
+      compact_index(compact_translit_word_to_keys_, translit_word_to_keys_, outdated_compact_keys_, {});
+  word_to_keys_.clear();
+  translit_word_to_keys_.clear();
+  outdated_compact_keys_.clear();
+  change_count_ = 0;
+}
+
+Hints::CompactWordIndex Hints::compact_index(const CompactWordIndex &old_index,
+                                             const std::map<string, vector<KeyT>> &word_to_keys,
+                                             const HashSet<KeyT> &outdated_keys,
+                                             const vector<std::pair<string, KeyT>> &new_word_keys) {
+  CompactWordIndex result;
+  vector<KeyT> keys;
+  size_t old_word_id = 0;
+  auto it = word_to_keys.begin();
+  size_t new_pos = 0;
+  while (old_word_id != old_index.word_count() || it != word_to_keys.end() || new_pos != new_word_keys.size()) {
+    // find the least word among all sources
+    Slice word;
+    bool has_word = false;
+    auto update_word = [&word, &has_word](Slice other_word) {
+      if (!has_word || other_word < word) {
+        word = other_word;
+        has_word = true;
+      }
+    };
+    if (old_word_id != old_index.word_count()) {
+      update_word(old_index.get_word(old_word_id));
+    }
+    if (it != word_to_keys.end()) {
+      update_word(it->first);
+    }
+    if (new_pos != new_word_keys.size()) {
+      update_word(new_word_keys[new_pos].first);
+    }
+
+    keys.clear();
+    if (old_word_id != old_index.word_count() && old_index.get_word(old_word_id) == word) {
+      old_index.get_keys(old_word_id++, keys);
+      if (!outdated_keys.empty()) {
+        keys.erase(std::remove_if(keys.begin(), keys.end(),
+                                  [&outdated_keys](KeyT key) { return outdated_keys.count(key) != 0; }),
+                   keys.end());
+      }
+    }
+    auto old_size = keys.size();
+    if (it != word_to_keys.end() && Slice(it->first) == word) {
+      keys.insert(keys.end(), it->second.begin(), it->second.end());
+      ++it;
+    }
+    while (new_pos != new_word_keys.size() && Slice(new_word_keys[new_pos].first) == word) {
+      keys.push_back(new_word_keys[new_pos++].second);
+    }
+    std::sort(keys.begin() + old_size, keys.end());
+    std::inplace_merge(keys.begin(), keys.begin() + old_size, keys.end());
+    if (!keys.empty()) {
+      result.append(word, keys);
+    }
+  }
+  return result;
 }
 
 void Hints::set_rating(KeyT key, RatingT rating) {
@@ -130,90 +681,176 @@ void Hints::set_rating(KeyT key, RatingT rating) {
   key_to_rating_[key] = rating;
 }
 
-void Hints::add_search_results(vector<KeyT> &results, const string &word,
-                               const std::map<string, vector<KeyT>> &word_to_keys) {
+Hints::RatingT Hints::get_rating(KeyT key) const {
+  auto it = key_to_rating_.find(key);
+  if (it != key_to_rating_.end()) {
+    return it->second;
+  }
+  if (snapshot_keys_.size() != 0 && changed_snapshot_keys_.count(key) == 0) {
+    auto pos = snapshot_keys_.find(key);
+    if (pos != snapshot_keys_.size()) {
+      return snapshot_keys_.get_rating(pos);
+    }
+  }
+  return RatingT();
+}
+
+void Hints::add_search_results(vector<KeyT> &results, vector<size_t> &run_ends, vector<KeyT> &unsorted_results,
+                               const string &word, const CompactWordIndex &compact_word_to_keys,
+                               const std::map<string, vector<KeyT>> &word_to_keys) const {
   LOG(DEBUG) << "Search for word " << word;
+  // every posting list of the compact index is a sorted run
+  for (auto word_id = compact_word_to_keys.lower_bound(word);
+       word_id != compact_word_to_keys.word_count() && begins_with(compact_word_to_keys.get_word(word_id), word);
+       word_id++) {
+    auto run_begin = results.size();
+    compact_word_to_keys.get_keys(word_id, results);
+    if (!outdated_compact_keys_.empty()) {
+      results.erase(std::remove_if(results.begin() + run_begin, results.end(),
+                                   [this](KeyT key) { return outdated_compact_keys_.count(key) != 0; }),
+                    results.end());
+    }
+    run_ends.push_back(results.size());
+  }
+
   auto it = word_to_keys.lower_bound(word);
   while (it != word_to_keys.end() && begins_with(it->first, word)) {
-    results.insert(results.end(), it->second.begin(), it->second.end());
+    unsorted_results.insert(unsorted_results.end(), it->second.begin(), it->second.end());
     ++it;
   }
 }
 
 vector<Hints::KeyT> Hints::search_word(const string &word) const {
   vector<KeyT> results;
-  add_search_results(results, word, translit_word_to_keys_);
+  vector<size_t> run_ends;
+  vector<KeyT> unsorted_results;
+  add_search_results(results, run_ends, unsorted_results, word, compact_translit_word_to_keys_,
+                     translit_word_to_keys_);
   for (auto w : get_word_transliterations(word, true)) {
-    add_search_results(results, w, word_to_keys_);
+    add_search_results(results, run_ends, unsorted_results, w, compact_word_to_keys_, word_to_keys_);
   }
 
-  std::sort(results.begin(), results.end());
+  if (!unsorted_results.empty()) {
+    std::sort(unsorted_results.begin(), unsorted_results.end());
+    if (results.empty()) {
+      results = std::move(unsorted_results);
+    } else {
+      results.insert(results.end(), unsorted_results.begin(), unsorted_results.end());
+    }
+    run_ends.push_back(results.size());
+  }
+
+  merge_sorted_runs(results, run_ends);
   results.erase(std::unique(results.begin(), results.end()), results.end());
   return results;
 }
 
+void Hints::intersect(vector<KeyT> &results, const vector<KeyT> &keys) {
+  const vector<KeyT> *short_keys = &results;
+  const vector<KeyT> *long_keys = &keys;
+  if (short_keys->size() > long_keys->size()) {
+    std::swap(short_keys, long_keys);
+  }
+
+  vector<KeyT> intersection;
+  if (long_keys->size() / 8 < short_keys->size()) {
+    // lists have comparable sizes, so a linear merge is faster
+    std::set_intersection(results.begin(), results.end(), keys.begin(), keys.end(), std::back_inserter(intersection));
+    results = std::move(intersection);
+    return;
+  }
+
+  // galloping search of every key from the shorter list in the longer list
+  auto long_begin = long_keys->begin();
+  size_t long_size = long_keys->size();
+  size_t pos = 0;
+  for (auto key : *short_keys) {
+    if (pos == long_size) {
+      break;
+    }
+    size_t step = 1;
+    while (pos + step < long_size && long_begin[pos + step] < key) {
+      step *= 2;
+    }
+    auto it = std::lower_bound(long_begin + pos + step / 2, long_begin + td::min(pos + step + 1, long_size), key);
+    pos = it - long_begin;
+    if (pos != long_size && *it == key) {
+      intersection.push_back(key);
+      pos++;
+    }
+  }
+  results = std::move(intersection);
+}
+
 std::pair<size_t, vector<Hints::KeyT>> Hints::search(Slice query, int32 limit, bool return_all_for_empty_query) const {
   // LOG(ERROR) << "Search " << query;
   vector<KeyT> results;
 
   if (limit < 0) {
-    return {key_to_name_.size(), std::move(results)};
+    return {size(), std::move(results)};
   }
 
   auto words = get_words(query, true);
   if (return_all_for_empty_query && words.empty()) {
-    results.reserve(key_to_name_.size());
+    results.reserve(size());
+    for (size_t i = 0; i < snapshot_keys_.size(); i++) {
+      auto key = snapshot_keys_.get_key(i);
+      if (changed_snapshot_keys_.count(key) == 0) {
+        results.push_back(key);
+      }
+    }
     for (auto &it : key_to_name_) {
       results.push_back(it.first);
     }
   }
 
-  for (size_t i = 0; i < words.size(); i++) {
-    vector<KeyT> keys = search_word(words[i]);
-    if (i == 0) {
-      results = std::move(keys);
-      continue;
+  if (!words.empty()) {
+    vector<vector<KeyT>> word_results;
+    for (auto &word : words) {
+      word_results.push_back(search_word(word));
     }
-
-    // now need to intersect two lists
-    size_t results_pos = 0;
-    size_t keys_pos = 0;
-    size_t new_results_size = 0;
-    while (results_pos != results.size() && keys_pos != keys.size()) {
-      if (results[results_pos] < keys[keys_pos]) {
-        results_pos++;
-      } else if (results[results_pos] > keys[keys_pos]) {
-        keys_pos++;
-      } else {
-        results[new_results_size++] = results[results_pos];
-        results_pos++;
-        keys_pos++;
-      }
+    std::sort(word_results.begin(), word_results.end(),
+              [](const vector<KeyT> &lhs, const vector<KeyT> &rhs) { return lhs.size() < rhs.size(); });
+    results = std::move(word_results[0]);
+    for (size_t i = 1; i < word_results.size() && !results.empty(); i++) {
+      intersect(results, word_results[i]);
     }
-    results.resize(new_results_size);
   }
 
   auto total_size = results.size();
-  if (total_size < static_cast<size_t>(limit)) {
-    std::sort(results.begin(), results.end(), CompareByRating(key_to_rating_));
-  } else {
-    std::partial_sort(results.begin(), results.begin() + limit, results.end(), CompareByRating(key_to_rating_));
-    results.resize(limit);
+  auto result_limit = static_cast<size_t>(limit);
+
+  // select best results using a bounded heap, which top is the worst of them
+  vector<std::pair<RatingT, KeyT>> best_results;
+  best_results.reserve(td::min(total_size, result_limit));
+  for (auto key : results) {
+    std::pair<RatingT, KeyT> result{get_rating(key), key};
+    if (best_results.size() < result_limit) {
+      best_results.push_back(result);
+      if (best_results.size() == result_limit && total_size > result_limit) {
+        std::make_heap(best_results.begin(), best_results.end());
+      }
+    } else if (result_limit != 0 && result < best_results[0]) {
+      std::pop_heap(best_results.begin(), best_results.end());
+      best_results.back() = result;
+      std::push_heap(best_results.begin(), best_results.end());
+    }
   }
+  std::sort(best_results.begin(), best_results.end());
 
+  results.clear();
+  for (auto &result : best_results) {
+    results.push_back(result.second);
+  }
   return {total_size, std::move(results)};
 }
 
 bool Hints::has_key(KeyT key) const {
-  return key_to_name_.find(key) != key_to_name_.end();
+  return !get_name(key).empty();
 }
 
 string Hints::key_to_string(KeyT key) const {
-  auto it = key_to_name_.find(key);
-  if (it == key_to_name_.end()) {
-    return string();
-  }
-  return it->second;
+  return get_name(key).str();
 }
 
 std::pair<size_t, vector<Hints::KeyT>> Hints::search_empty(int32 limit) const {
@@ -221,7 +858,112 @@ std::pair<size_t, vector<Hints::KeyT>> Hints::search_empty(int32 limit) const {
 }
 
 size_t Hints::size() const {
-  return key_to_name_.size();
+  return snapshot_keys_.size() - changed_snapshot_keys_.size() + key_to_name_.size();
+}
+
+Status Hints::save_snapshot(CSlice path) const {
+  struct KeyInfo {
+    KeyT key;
+    Slice name;
+    RatingT rating;
+    bool operator<(const KeyInfo &other) const {
+      return key < other.key;
+    }
+  };
+  vector<KeyInfo> keys;
+  keys.reserve(size());
+  for (size_t i = 0; i < snapshot_keys_.size(); i++) {
+    auto key = snapshot_keys_.get_key(i);
+    if (changed_snapshot_keys_.count(key) == 0) {
+      keys.push_back(KeyInfo{key, snapshot_keys_.get_name(i), get_rating(key)});
+    }
+  }
+  for (auto &it : key_to_name_) {
+    keys.push_back(KeyInfo{it.first, it.second, get_rating(it.first)});
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // ratings of keys without names are kept too
+  vector<KeyT> rating_keys;
+  vector<RatingT> ratings;
+  for (auto &it : key_to_rating_) {
+    if (!has_key(it.first)) {
+      rating_keys.push_back(it.first);
+      ratings.push_back(it.second);
+    }
+  }
+
+  auto word_to_keys = compact_index(compact_word_to_keys_, word_to_keys_, outdated_compact_keys_, {});
+  auto translit_word_to_keys =
+      compact_index(compact_translit_word_to_keys_, translit_word_to_keys_, outdated_compact_keys_, {});
+
+  auto temp_path = PSTRING() << path << ".tmp";
+  TRY_RESULT(fd, FileFd::open(temp_path, FileFd::Write | FileFd::Create | FileFd::Truncate));
+  HintsSnapshotWriter writer(fd);
+  writer.store_uint64(HINTS_SNAPSHOT_MAGIC);
+  writer.store_uint64(HINTS_SNAPSHOT_VERSION);
+  word_to_keys.store(writer);
+  translit_word_to_keys.store(writer);
+
+  writer.store_uint64(keys.size());
+  uint64 names_size = 0;
+  vector<uint64> name_offsets{0};
+  for (auto &key_info : keys) {
+    names_size += key_info.name.size();
+    name_offsets.push_back(names_size);
+  }
+  writer.store_uint64(names_size);
+  writer.store_array(transform(keys, [](const KeyInfo &key_info) { return key_info.key; }).data(), keys.size());
+  writer.store_array(transform(keys, [](const KeyInfo &key_info) { return key_info.rating; }).data(), keys.size());
+  writer.store_array(name_offsets.data(), name_offsets.size());
+  for (auto &key_info : keys) {
+    writer.store_bytes(key_info.name);
+  }
+  writer.align();
+
+  writer.store_uint64(rating_keys.size());
+  writer.store_array(rating_keys.data(), rating_keys.size());
+  writer.store_array(ratings.data(), ratings.size());
+
+  auto status = writer.finish();
+  if (status.is_ok()) {
+    status = fd.sync();
+  }
+  fd.close();
+  if (status.is_error()) {
+    unlink(temp_path).ignore();
+    return status;
+  }
+  return rename(temp_path, path);
+}
+
+Result<Hints> Hints::open_snapshot(CSlice path) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  TRY_RESULT(mapping, MemoryMapping::create_from_file(fd));
+  fd.close();
+
+  Hints result;
+  result.snapshot_ = make_unique<MemoryMapping>(std::move(mapping));
+  HintsSnapshotParser parser(result.snapshot_->as_slice());
+  TRY_RESULT(magic, parser.fetch_uint64());
+  TRY_RESULT(version, parser.fetch_uint64());
+  if (magic != HINTS_SNAPSHOT_MAGIC || version != HINTS_SNAPSHOT_VERSION) {
+    return Status::Error("Wrong Hints snapshot format");
+  }
+  TRY_STATUS(result.compact_word_to_keys_.parse(parser));
+  TRY_STATUS(result.compact_translit_word_to_keys_.parse(parser));
+  TRY_STATUS(result.snapshot_keys_.parse(parser));
+
+  TRY_RESULT(rating_count, parser.fetch_uint64());
+  TRY_RESULT(rating_keys, parser.fetch_array<KeyT>(rating_count));
+  TRY_RESULT(ratings, parser.fetch_array<RatingT>(rating_count));
+  for (size_t i = 0; i < rating_keys.size(); i++) {
+    result.key_to_rating_[rating_keys[i]] = ratings[i];
+  }
+  if (!parser.empty()) {
+    return Status::Error("Hints snapshot has unexpected data at the end");
+  }
+  return std::move(result);
 }
 
 }  // namespace td
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "td/utils/common.h"
+#include "td/utils/HashSet.h"
+#include "td/utils/port/MemoryMapping.h"
 #include "td/utils/Slice.h"
+#include "td/utils/Span.h"
+#include "td/utils/Status.h"
 
 #include <map>
 #include <unordered_map>
@@ -17,6 +21,10 @@ class Hints {
  public:
   void add(KeyT key, Slice name);
 
+  // has the same effect as add called for every pair in order, but splits names into words in parallel
+  // and merges big batches directly into the index
+  void add_batch(Span<std::pair<KeyT, Slice>> names);
+
   void remove(KeyT key) {
     add(key, "");
   }
@@ -35,12 +43,111 @@ class Hints {
 
   size_t size() const;
 
+  // saves all keys with their names and ratings and the built search index to a file
+  Status save_snapshot(CSlice path) const TD_WARN_UNUSED_RESULT;
+
+  // opens a snapshot saved by save_snapshot; the index is used directly from a read-only memory mapping of the file,
+  // and all subsequent changes are kept in memory
+  static Result<Hints> open_snapshot(CSlice path) TD_WARN_UNUSED_RESULT;
+
  private:
+  // Immutable sorted list of words, stored in one string, with sorted lists of keys for every word,
+  // delta-encoded as varints. Is stored either in memory or in a snapshot.
+  class CompactWordIndex {
+   public:
+    // words must be appended in increasing order, keys must be sorted and unique
+    void append(Slice word, const vector<KeyT> &keys);
+
+    size_t word_count() const {
+      return word_offsets_.empty() ? 0 : word_offsets_.size() - 1;
+    }
+    size_t entry_count() const {
+      return entry_count_;
+    }
+
+    Slice get_word(size_t word_id) const {
+      return words_.substr(word_offsets_[word_id], word_offsets_[word_id + 1] - word_offsets_[word_id]);
+    }
+
+    // appends keys of the word to the end of keys
+    void get_keys(size_t word_id, vector<KeyT> &keys) const;
+
+    // returns the first word, which isn't less than the prefix
+    size_t lower_bound(Slice prefix) const;
+
+    template <class StorerT>
+    void store(StorerT &storer) const;
+
+    template <class ParserT>
+    Status parse(ParserT &parser);
+
+   private:
+    struct Storage {
+      string words;
+      vector<uint32> word_offsets{0};
+      string postings;
+      vector<uint32> posting_offsets{0};
+    };
+    unique_ptr<Storage> storage_;  // is empty if the index is stored in a snapshot
+
+    Slice words_;
+    Span<uint32> word_offsets_;
+    Slice postings_;
+    Span<uint32> posting_offsets_;
+    size_t entry_count_ = 0;
+  };
+
+  // Immutable sorted list of keys with their names and ratings, stored in a snapshot
+  class CompactKeyTable {
+   public:
+    size_t size() const {
+      return keys_.size();
+    }
+
+    KeyT get_key(size_t pos) const {
+      return keys_[pos];
+    }
+    Slice get_name(size_t pos) const {
+      return names_.substr(static_cast<size_t>(name_offsets_[pos]),
+                           static_cast<size_t>(name_offsets_[pos + 1] - name_offsets_[pos]));
+    }
+    RatingT get_rating(size_t pos) const {
+      return ratings_[pos];
+    }
+
+    // returns size() if the key isn't found
+    size_t find(KeyT key) const;
+
+    template <class ParserT>
+    Status parse(ParserT &parser);
+
+   private:
+    Span<KeyT> keys_;
+    Span<RatingT> ratings_;
+    Span<uint64> name_offsets_;
+    Slice names_;
+  };
+
+  // recently changed keys are stored in word_to_keys_ and translit_word_to_keys_;
+  // all other keys are stored in the compact indexes, which are rebuilt when there are enough changes
   std::map<string, vector<KeyT>> word_to_keys_;
   std::map<string, vector<KeyT>> translit_word_to_keys_;
+  CompactWordIndex compact_word_to_keys_;
+  CompactWordIndex compact_translit_word_to_keys_;
+  HashSet<KeyT> outdated_compact_keys_;  // keys, which must be ignored in the compact indexes
+  size_t change_count_ = 0;
+
+  // keys with names from the opened snapshot; names and ratings of changed keys are stored in the maps
+  unique_ptr<MemoryMapping> snapshot_;
+  CompactKeyTable snapshot_keys_;
+  HashSet<KeyT> changed_snapshot_keys_;
+
   std::unordered_map<KeyT, string> key_to_name_;
   std::unordered_map<KeyT, RatingT> key_to_rating_;
 
+  static constexpr size_t MIN_COMPACTION_CHANGE_COUNT = 1 << 12;  // small sets of keys are never compacted
+  static constexpr size_t MIN_THREAD_NAME_COUNT = 1 << 10;
+
   static void add_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
   static void delete_word(const string &word, KeyT key, std::map<string, vector<KeyT>> &word_to_keys);
 
@@ -48,32 +155,34 @@ class Hints {
 
   static vector<string> get_words(Slice name, bool is_search);
 
-  static void add_search_results(vector<KeyT> &results, const string &word,
-                                 const std::map<string, vector<KeyT>> &word_to_keys);
+  static vector<string> get_transliterations(const vector<string> &words);
 
-  vector<KeyT> search_word(const string &word) const;
+  void delete_key_words(KeyT key, Slice name);
 
-  class CompareByRating {
-    const std::unordered_map<KeyT, RatingT> &key_to_rating_;
+  // changes the name of the key and deletes its old words; returns false if nothing was changed
+  bool change_name(KeyT key, Slice name);
 
-    RatingT get_rating(const KeyT &key) const {
-      auto it = key_to_rating_.find(key);
-      if (it == key_to_rating_.end()) {
-        return RatingT();
-      }
-      return it->second;
-    }
+  Slice get_name(KeyT key) const;
 
-   public:
-    explicit CompareByRating(const std::unordered_map<KeyT, RatingT> &key_to_rating) : key_to_rating_(key_to_rating) {
-    }
+  void on_change();
 
-    bool operator()(const KeyT &lhs, const KeyT &rhs) const {
-      auto lhs_rating = get_rating(lhs);
-      auto rhs_rating = get_rating(rhs);
-      return lhs_rating < rhs_rating || (lhs_rating == rhs_rating && lhs < rhs);
-    }
-  };
+  void compact();
+
+  // new_word_keys must be sorted
+  static CompactWordIndex compact_index(const CompactWordIndex &old_index,
+                                        const std::map<string, vector<KeyT>> &word_to_keys,
+                                        const HashSet<KeyT> &outdated_keys,
+                                        const vector<std::pair<string, KeyT>> &new_word_keys);
+
+  void add_search_results(vector<KeyT> &results, vector<size_t> &run_ends, vector<KeyT> &unsorted_results,
+                          const string &word, const CompactWordIndex &compact_word_to_keys,
+                          const std::map<string, vector<KeyT>> &word_to_keys) const;
+
+  vector<KeyT> search_word(const string &word) const;
+
+  static void intersect(vector<KeyT> &results, const vector<KeyT> &keys);
+
+  RatingT get_rating(KeyT key) const;
 };
 
 }  // namespace td
@@ -0,0 +1,290 @@
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/ThreadLocalStorage.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace td {
+
+namespace detail {
+
+// Log-linear bucketing of unsigned values: values less than 2^PrecisionBits have their own buckets,
+// and each range [2^e, 2^(e + 1)) is split into 2^PrecisionBits buckets of equal width,
+// so any value in a bucket differs from the bucket bounds by less than 2^-PrecisionBits of the value.
+// Values not less than 2^MaxValueBits are put in the last bucket.
+template <int PrecisionBits, int MaxValueBits>
+struct LogHistogramBuckets {
+  static_assert(0 < PrecisionBits && PrecisionBits < MaxValueBits && MaxValueBits <= 63, "Invalid histogram bits");
+
+  static constexpr size_t BUCKET_COUNT = static_cast<size_t>(MaxValueBits - PrecisionBits + 1) << PrecisionBits;
+  static constexpr uint64 MAX_VALUE = (static_cast<uint64>(1) << MaxValueBits) - 1;
+
+  static size_t get_bucket(uint64 value) {
+    if (value < (static_cast<uint64>(1) << PrecisionBits)) {
+      return static_cast<size_t>(value);
+    }
+    if (value > MAX_VALUE) {
+      value = MAX_VALUE;
+    }
+    auto shift = 63 - count_leading_zeroes64(value) - PrecisionBits;
+    return (static_cast<size_t>(shift) << PrecisionBits) + static_cast<size_t>(value >> shift);
+  }
+
+  static uint64 get_bucket_lower_bound(size_t bucket) {
+    if (bucket < (static_cast<size_t>(1) << PrecisionBits)) {
+      return bucket;
+    }
+    auto shift = static_cast<int>(bucket >> PrecisionBits) - 1;
+    auto mantissa = (static_cast<uint64>(1) << PrecisionBits) + (bucket & ((static_cast<size_t>(1) << PrecisionBits) - 1));
+    return mantissa << shift;
+  }
+
+  static uint64 get_bucket_upper_bound(size_t bucket) {
+    if (bucket < (static_cast<size_t>(1) << PrecisionBits)) {
+      return bucket;
+    }
+    auto shift = static_cast<int>(bucket >> PrecisionBits) - 1;
+    return get_bucket_lower_bound(bucket) + (static_cast<uint64>(1) << shift) - 1;
+  }
+};
+
+}  // namespace detail
+
+// HDR-style histogram of non-negative integer values, for example, of latencies in microseconds.
+// Recording is O(1), merging is O(number of buckets), and percentiles have relative error below 2^-PrecisionBits.
+// Can be used as StatT of TimedStat to get percentiles over a sliding window.
+// Buckets are allocated on the first recorded value, so empty histograms are cheap to create and copy.
+template <int PrecisionBits = 6, int MaxValueBits = 40>
+class LogHistogram {
+  using Buckets = detail::LogHistogramBuckets<PrecisionBits, MaxValueBits>;
+
+ public:
+  static constexpr size_t BUCKET_COUNT = Buckets::BUCKET_COUNT;
+
+  void on_event(uint64 value) {
+    add(value);
+  }
+
+  void add(uint64 value, uint64 count = 1) {
+    if (count == 0) {
+      return;
+    }
+    if (buckets_.empty()) {
+      buckets_.resize(BUCKET_COUNT);
+    }
+    buckets_[Buckets::get_bucket(value)] += count;
+    update_totals(count, value * count, value, value);
+  }
+
+  void merge(const LogHistogram &other) {
+    if (other.count_ == 0) {
+      return;
+    }
+    if (buckets_.empty()) {
+      buckets_.resize(BUCKET_COUNT);
+    }
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      buckets_[i] += other.buckets_[i];
+    }
+    update_totals(other.count_, other.sum_, other.min_, other.max_);
+  }
+
+  void clear() {
+    *this = LogHistogram();
+  }
+
+  uint64 get_count() const {
+    return count_;
+  }
+  uint64 get_sum() const {
+    return sum_;
+  }
+  uint64 get_min() const {
+    return count_ == 0 ? 0 : min_;
+  }
+  uint64 get_max() const {
+    return max_;
+  }
+  double get_mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_);
+  }
+
+  // returns the least value, such that at least percent% of the recorded values are not greater than it, up to the error;
+  // the result is the upper bound of a bucket clamped to the exact minimum and maximum, so get_percentile(100) is exact
+  uint64 get_percentile(double percent) const {
+    if (count_ == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64>(std::ceil(percent / 100.0 * static_cast<double>(count_) - 1e-9));
+    if (rank == 0) {
+      rank = 1;
+    }
+    if (rank >= count_) {
+      return max_;
+    }
+    uint64 total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      total += buckets_[i];
+      if (total >= rank) {
+        return td::min(td::max(Buckets::get_bucket_upper_bound(i), min_), max_);
+      }
+    }
+    UNREACHABLE();
+    return max_;
+  }
+
+  // calls f(lower_bound, upper_bound, count) for each non-empty bucket in increasing order
+  template <class F>
+  void for_each_bucket(F &&f) const {
+    for (size_t i = 0; i < buckets_.size(); i++) {
+      if (buckets_[i] != 0) {
+        f(Buckets::get_bucket_lower_bound(i), Buckets::get_bucket_upper_bound(i), buckets_[i]);
+      }
+    }
+  }
+
+ private:
+  template <int P, int M>
+  friend class ThreadSafeLogHistogram;
+
+  vector<uint64> buckets_;
+  uint64 count_ = 0;
+  uint64 sum_ = 0;
+  uint64 min_ = std::numeric_limits<uint64>::max();
+  uint64 max_ = 0;
+
+  void update_totals(uint64 count, uint64 sum, uint64 min_value, uint64 max_value) {
+    count_ += count;
+    sum_ += sum;
+    min_ = td::min(min_, min_value);
+    max_ = td::max(max_, max_value);
+  }
+};
+
+template <int PrecisionBits, int MaxValueBits>
+void to_json(JsonValueScope &jv, const LogHistogram<PrecisionBits, MaxValueBits> &histogram) {
+  auto object = jv.enter_object();
+  object("count", JsonLong(static_cast<int64>(histogram.get_count())));
+  object("min", JsonLong(static_cast<int64>(histogram.get_min())));
+  object("max", JsonLong(static_cast<int64>(histogram.get_max())));
+  object("mean", JsonFloat(histogram.get_mean()));
+  object("p50", JsonLong(static_cast<int64>(histogram.get_percentile(50))));
+  object("p90", JsonLong(static_cast<int64>(histogram.get_percentile(90))));
+  object("p99", JsonLong(static_cast<int64>(histogram.get_percentile(99))));
+  object("p999", JsonLong(static_cast<int64>(histogram.get_percentile(99.9))));
+}
+
+// LogHistogram, which can be recorded from any thread. Each td::thread writes only to its own buckets without
+// read-modify-write operations, and get_histogram() merges buckets of all threads, so it is O(threads * buckets).
+// Threads not created by td::thread share identifier 0, so they write to the shared buckets with atomic operations.
+// Values recorded concurrently with get_histogram() may be partially visible in the result
+template <int PrecisionBits = 6, int MaxValueBits = 40>
+class ThreadSafeLogHistogram {
+  using Buckets = detail::LogHistogramBuckets<PrecisionBits, MaxValueBits>;
+
+ public:
+  using Histogram = LogHistogram<PrecisionBits, MaxValueBits>;
+
+  void add(uint64 value) {
+    auto thread_id = get_thread_id();
+    auto &shard = shards_.get(static_cast<size_t>(thread_id));
+    auto *buckets = shard.buckets.load(std::memory_order_acquire);
+    if (unlikely(buckets == nullptr)) {
+      buckets = shard.init_buckets();
+    }
+    bool is_shared = thread_id == 0;
+    increment(buckets[Buckets::get_bucket(value)], 1, is_shared);
+    increment(shard.sum, value, is_shared);
+    update(shard.min, value, is_shared, [](uint64 old_value, uint64 new_value) { return new_value < old_value; });
+    update(shard.max, value, is_shared, [](uint64 old_value, uint64 new_value) { return new_value > old_value; });
+  }
+
+  Histogram get_histogram() const {
+    Histogram result;
+    shards_.for_each([&](const Shard &shard) {
+      auto *buckets = shard.buckets.load(std::memory_order_acquire);
+      if (buckets == nullptr) {
+        return;
+      }
+      if (result.buckets_.empty()) {
+        result.buckets_.resize(Histogram::BUCKET_COUNT);
+      }
+      uint64 count = 0;
+      for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+        auto bucket_count = buckets[i].load(std::memory_order_relaxed);
+        result.buckets_[i] += bucket_count;
+        count += bucket_count;
+      }
+      if (count != 0) {
+        result.update_totals(count, shard.sum.load(std::memory_order_relaxed), shard.min.load(std::memory_order_relaxed),
+                             shard.max.load(std::memory_order_relaxed));
+      }
+    });
+    return result;
+  }
+
+ private:
+  struct Shard {
+    std::atomic<std::atomic<uint64> *> buckets{nullptr};
+    std::atomic<uint64> sum{0};
+    std::atomic<uint64> min{std::numeric_limits<uint64>::max()};
+    std::atomic<uint64> max{0};
+
+    Shard() = default;
+    Shard(const Shard &) = delete;
+    Shard &operator=(const Shard &) = delete;
+    Shard(Shard &&) = delete;
+    Shard &operator=(Shard &&) = delete;
+    ~Shard() {
+      delete[] buckets.load(std::memory_order_relaxed);
+    }
+
+    // can be called concurrently for the shared shard, so only one of the allocated arrays is kept
+    std::atomic<uint64> *init_buckets() {
+      auto *result = new std::atomic<uint64>[Histogram::BUCKET_COUNT];
+      for (size_t i = 0; i < Histogram::BUCKET_COUNT; i++) {
+        result[i].store(0, std::memory_order_relaxed);
+      }
+      std::atomic<uint64> *expected = nullptr;
+      if (!buckets.compare_exchange_strong(expected, result, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        delete[] result;
+        return expected;
+      }
+      return result;
+    }
+  };
+  ThreadLocalStorage<Shard> shards_;
+
+  // unless the shard is shared, only the owning thread modifies the value
+  static void increment(std::atomic<uint64> &value, uint64 diff, bool is_shared) {
+    if (is_shared) {
+      value.fetch_add(diff, std::memory_order_relaxed);
+    } else {
+      value.store(value.load(std::memory_order_relaxed) + diff, std::memory_order_relaxed);
+    }
+  }
+
+  template <class F>
+  static void update(std::atomic<uint64> &value, uint64 new_value, bool is_shared, F &&is_better) {
+    auto old_value = value.load(std::memory_order_relaxed);
+    if (!is_better(old_value, new_value)) {
+      return;
+    }
+    if (!is_shared) {
+      value.store(new_value, std::memory_order_relaxed);
+      return;
+    }
+    while (is_better(old_value, new_value) &&
+           !value.compare_exchange_weak(old_value, new_value, std::memory_order_relaxed)) {
+    }
+  }
+};
+
+}  // namespace td
@@ -1,9 +1,11 @@
 #include "td/utils/JsonBuilder.h"
 
+#include "td/utils/Arena.h"
 #include "td/utils/misc.h"
 #include "td/utils/ScopeGuard.h"
 
 #include <cstring>
+#include <iterator>
 
 namespace td {
 
@@ -358,10 +360,12 @@ Result<JsonValue> do_json_decode(Parser &parser, int32 max_depth) {
     case '[': {
       parser.skip('[');
       parser.skip_whitespaces();
-      std::vector<JsonValue> res;
       if (parser.try_skip(']')) {
-        return JsonValue::create_array(std::move(res));
+        return JsonValue::create_array(JsonArray());
       }
+      // elements are collected in temporary memory to allocate the resulting array only once
+      ArenaScope scope;
+      ArenaVector<JsonValue> res{ArenaAllocator<JsonValue>(scope.arena())};
       while (true) {
         if (parser.empty()) {
           return Status::Error("Unexpected string end");
@@ -382,15 +386,16 @@ Result<JsonValue> do_json_decode(Parser &parser, int32 max_depth) {
         }
         return Status::Error("Unexpected symbol while parsing JSON Array");
       }
-      return JsonValue::create_array(std::move(res));
+      return JsonValue::create_array(JsonArray(std::make_move_iterator(res.begin()), std::make_move_iterator(res.end())));
     }
     case '{': {
       parser.skip('{');
       parser.skip_whitespaces();
-      std::vector<std::pair<MutableSlice, JsonValue> > res;
       if (parser.try_skip('}')) {
-        return JsonValue::make_object(std::move(res));
+        return JsonValue::make_object(JsonObject());
       }
+      ArenaScope scope;
+      ArenaVector<std::pair<MutableSlice, JsonValue>> res{ArenaAllocator<std::pair<MutableSlice, JsonValue>>(scope.arena())};
       while (true) {
         if (parser.empty()) {
           return Status::Error("Unexpected string end");
@@ -416,7 +421,7 @@ Result<JsonValue> do_json_decode(Parser &parser, int32 max_depth) {
         }
         return Status::Error("Unexpected symbol while parsing JSON Object");
       }
-      return JsonValue::make_object(std::move(res));
+      return JsonValue::make_object(JsonObject(std::make_move_iterator(res.begin()), std::make_move_iterator(res.end())));
     }
     case '-':
     case '+':
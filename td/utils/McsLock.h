@@ -0,0 +1,100 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/SpinLock.h"
+
+#include <atomic>
+
+namespace td {
+
+// MCS queue lock
+// Waiters form a linked list of nodes, each of them spins only on its own node, and the lock is passed in FIFO order.
+// Suits locks with many simultaneous waiters. The node must stay alive until unlock, so use McsLock::Guard.
+class McsLock {
+ public:
+  class Node {
+   public:
+    Node() = default;
+    Node(const Node &other) = delete;
+    Node &operator=(const Node &other) = delete;
+    Node(Node &&other) = delete;
+    Node &operator=(Node &&other) = delete;
+    ~Node() = default;
+
+   private:
+    friend class McsLock;
+    std::atomic<Node *> next_{nullptr};
+    std::atomic<bool> is_locked_{false};
+    char pad_[TD_CONCURRENCY_PAD - sizeof(std::atomic<Node *>) - sizeof(std::atomic<bool>)];
+  };
+
+  class Guard {
+   public:
+    explicit Guard(McsLock &lock) : lock_(lock) {
+      lock_.lock(node_);
+    }
+    Guard(const Guard &other) = delete;
+    Guard &operator=(const Guard &other) = delete;
+    Guard(Guard &&other) = delete;
+    Guard &operator=(Guard &&other) = delete;
+    ~Guard() {
+      lock_.unlock(node_);
+    }
+
+   private:
+    McsLock &lock_;
+    Node node_;
+  };
+
+  void lock(Node &node) {
+    node.next_.store(nullptr, std::memory_order_relaxed);
+    node.is_locked_.store(true, std::memory_order_relaxed);
+    auto *prev = tail_.exchange(&node, std::memory_order_acq_rel);
+    if (prev == nullptr) {
+      return;
+    }
+    prev->next_.store(&node, std::memory_order_release);
+    detail::SpinBackoff backoff;
+    while (node.is_locked_.load(std::memory_order_acquire)) {
+      if (!backoff.next()) {
+        td::this_thread::yield();
+      }
+    }
+    if (stats_ != nullptr) {
+      stats_->contended.fetch_add(1, std::memory_order_relaxed);
+      stats_->spins.fetch_add(backoff.get_count(), std::memory_order_relaxed);
+    }
+  }
+
+  bool try_lock(Node &node) {
+    node.next_.store(nullptr, std::memory_order_relaxed);
+    Node *expected = nullptr;
+    return tail_.compare_exchange_strong(expected, &node, std::memory_order_acq_rel, std::memory_order_relaxed);
+  }
+
+  void unlock(Node &node) {
+    auto *next = node.next_.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      auto *expected = &node;
+      if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return;
+      }
+      // a successor has already taken its place in the queue, but hasn't linked itself yet
+      while ((next = node.next_.load(std::memory_order_acquire)) == nullptr) {
+        detail::cpu_relax();
+      }
+    }
+    next->is_locked_.store(false, std::memory_order_release);
+  }
+
+  // stats must outlive the lock
+  void set_stats(LockStats *stats) {
+    stats_ = stats;
+  }
+
+ private:
+  std::atomic<Node *> tail_{nullptr};
+  LockStats *stats_{nullptr};
+};
+
+}  // namespace td
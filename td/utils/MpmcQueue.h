@@ -10,6 +10,7 @@
 #include "td/utils/logging.h"
 #include "td/utils/port/thread.h"
 #include "td/utils/ScopeGuard.h"
+#include "td/utils/ThreadLocalStorage.h"
 
 #include <array>
 #include <atomic>
@@ -35,12 +36,12 @@ struct MpmcStat {
     int alloc_error_cnt = 0;
     int push_loop_error_cnt = 0;
     int push_loop_ok_cnt = 0;
-    for (auto &d : arr) {
+    arr.for_each([&](const ThreadStat &d) {
       alloc_ok_cnt += d.alloc_ok_cnt;
       alloc_error_cnt += d.alloc_error_cnt;
       push_loop_error_cnt += d.push_loop_error_cnt;
       push_loop_ok_cnt += d.push_loop_ok_cnt;
-    }
+    });
     LOG(ERROR) << tag("alloc_ok_cnt", alloc_ok_cnt) << tag("alloc_error_cnt", alloc_error_cnt)
                << tag("push_loop_error_cnt", push_loop_error_cnt) << tag("push_loop_ok_cnt", push_loop_ok_cnt);
   }
@@ -51,11 +52,10 @@ struct MpmcStat {
     int alloc_error_cnt{0};
     int push_loop_ok_cnt{0};
     int push_loop_error_cnt{0};
-    char pad[TD_CONCURRENCY_PAD - sizeof(int) * 4];
   };
-  std::array<ThreadStat, 1024> arr;
+  ThreadLocalStorage<ThreadStat> arr;
   ThreadStat &s(size_t thread_id) {
-    return arr[thread_id];
+    return arr.get(thread_id);
   }
 };
 }  // namespace detail
@@ -22,6 +22,20 @@ class MpscLinkQueueImpl {
     head_.store(node, std::memory_order_relaxed);
   }
 
+  // moves all nodes from the reader to the queue with one CAS; order of the nodes isn't preserved
+  void push_all(Reader &reader) {
+    auto *head = reader.head_;
+    if (head == nullptr) {
+      return;
+    }
+    auto *tail = reader.tail_;
+    reader.head_ = nullptr;
+    reader.tail_ = nullptr;
+    tail->next_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_strong(tail->next_, head, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+
   void pop_all(Reader &reader) {
     return reader.add(head_.exchange(nullptr, std::memory_order_acquire));
   }
@@ -127,6 +141,9 @@ class MpscLinkQueue {
     }
   };
 
+  void push_all(Reader &reader) {
+    impl_.push_all(reader.impl());
+  }
   void pop_all(Reader &reader) {
     return impl_.pop_all(reader.impl());
   }
@@ -6,52 +6,70 @@
 
 #if !TD_EVENTFD_UNSUPPORTED
 
-#include "td/utils/SpinLock.h"
-
+#include <atomic>
 #include <utility>
 
 namespace td {
 // interface like in PollableQueue
+// Writers push nodes into a lock-free intrusive stack, the reader takes the whole stack at once.
+// When the reader finds the queue empty, it replaces the head with a special "waiting" marker;
+// only the writer which replaces the marker calls EventFd::release, so a burst of puts costs
+// at most one write to the event fd.
 template <class T>
 class MpscPollableQueue {
  public:
   using ValueType = T;
 
+  MpscPollableQueue() = default;
+  MpscPollableQueue(const MpscPollableQueue &) = delete;
+  MpscPollableQueue &operator=(const MpscPollableQueue &) = delete;
+  MpscPollableQueue(MpscPollableQueue &&) = delete;
+  MpscPollableQueue &operator=(MpscPollableQueue &&) = delete;
+  ~MpscPollableQueue() {
+    clear_nodes();
+  }
+
   int reader_wait_nonblock() {
-    auto ready = reader_vector_.size() - reader_pos_;
-    if (ready != 0) {
-      return narrow_cast<int>(ready);
+    if (reader_ready_ != 0) {
+      return narrow_cast<int>(reader_ready_);
     }
 
     for (int i = 0; i < 2; i++) {
-      auto guard = lock_.lock();
-      if (writer_vector_.empty()) {
+      auto *head = head_.exchange(nullptr, std::memory_order_acquire);
+      if (head == nullptr || head == waiting_marker()) {
         if (i == 1) {
-          wait_event_fd_ = true;
-          return 0;
+          Node *expected = nullptr;
+          if (head_.compare_exchange_strong(expected, waiting_marker(), std::memory_order_acq_rel)) {
+            return 0;
+          }
+          // some writer has just pushed a value
+          head = head_.exchange(nullptr, std::memory_order_acquire);
         }
-      } else {
-        reader_vector_.clear();
-        reader_pos_ = 0;
-        std::swap(writer_vector_, reader_vector_);
-        return narrow_cast<int>(reader_vector_.size());
+      }
+      if (head != nullptr && head != waiting_marker()) {
+        reader_add(head);
+        return narrow_cast<int>(reader_ready_);
       }
       event_fd_.acquire();
     }
     UNREACHABLE();
   }
   ValueType reader_get_unsafe() {
-    return std::move(reader_vector_[reader_pos_++]);
+    auto node = unique_ptr<Node>(reader_head_);
+    reader_head_ = node->next;
+    reader_ready_--;
+    return std::move(node->value);
   }
   void reader_flush() {
     //nop
   }
   void writer_put(ValueType value) {
-    auto guard = lock_.lock();
-    writer_vector_.push_back(std::move(value));
-    if (wait_event_fd_) {
-      wait_event_fd_ = false;
-      guard.reset();
+    auto *node = new Node(std::move(value));
+    auto *head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next = head == waiting_marker() ? nullptr : head;
+    } while (!head_.compare_exchange_weak(head, node, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (head == waiting_marker()) {
       event_fd_.release();
     }
   }
@@ -68,10 +86,7 @@ class MpscPollableQueue {
   void destroy() {
     if (!event_fd_.empty()) {
       event_fd_.close();
-      wait_event_fd_ = false;
-      writer_vector_.clear();
-      reader_vector_.clear();
-      reader_pos_ = 0;
+      clear_nodes();
     }
   }
 
@@ -85,12 +100,51 @@ class MpscPollableQueue {
   }
 
  private:
-  SpinLock lock_;
-  bool wait_event_fd_{false};
+  struct Node {
+    explicit Node(ValueType &&value) : value(std::move(value)) {
+    }
+    Node *next{nullptr};
+    ValueType value;
+  };
+
+  std::atomic<Node *> head_{nullptr};
+  char pad_[TD_CONCURRENCY_PAD - sizeof(std::atomic<Node *>)];
   EventFd event_fd_;
-  std::vector<ValueType> writer_vector_;
-  std::vector<ValueType> reader_vector_;
-  size_t reader_pos_{0};
+  Node *reader_head_{nullptr};
+  size_t reader_ready_{0};
+
+  static Node *waiting_marker() {
+    static Node *marker = reinterpret_cast<Node *>(&marker);
+    return marker;
+  }
+
+  // nodes are pushed in reverse order, so reverse them back
+  void reader_add(Node *head) {
+    CHECK(reader_head_ == nullptr);
+    while (head != nullptr) {
+      auto *next = head->next;
+      head->next = reader_head_;
+      reader_head_ = head;
+      reader_ready_++;
+      head = next;
+    }
+  }
+
+  void clear_nodes() {
+    auto *head = head_.exchange(nullptr, std::memory_order_acquire);
+    if (head == waiting_marker()) {
+      head = nullptr;
+    }
+    while (head != nullptr) {
+      auto node = unique_ptr<Node>(head);
+      head = node->next;
+    }
+    while (reader_head_ != nullptr) {
+      auto node = unique_ptr<Node>(reader_head_);
+      reader_head_ = node->next;
+    }
+    reader_ready_ = 0;
+  }
 };
 
 }  // namespace td
@@ -2,6 +2,7 @@
 
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/misc.h"
 
 #include <atomic>
 #include <memory>
@@ -180,12 +181,24 @@ class ObjectPool {
     while (head_.load()) {
       auto to_delete = head_.load();
       head_ = to_delete->next;
-      delete to_delete;
       storage_count_--;
     }
     LOG_CHECK(storage_count_.load() == 0) << storage_count_.load();
   }
 
+  // Allocates n storages in one slab and puts them to the free list, so next n objects are created without
+  // heap allocations. Must be called from the thread, which creates objects
+  void reserve(size_t n) {
+    if (n == 0) {
+      return;
+    }
+    auto *storages = new_slab(n);
+    storage_count_ += narrow_cast<int32>(n);
+    for (size_t i = n; i > 0; i--) {
+      release_storage(&storages[i - 1]);
+    }
+  }
+
  private:
   struct Storage {
     // union {
@@ -206,18 +219,35 @@ class ObjectPool {
     }
   };
 
+  static constexpr size_t SLAB_SIZE = 4096;
+
   std::atomic<int32> storage_count_{0};
   std::atomic<Storage *> head_{static_cast<Storage *>(nullptr)};
   bool check_empty_flag_ = false;
 
-  // TODO(perf): allocation Storages in chunks? Anyway we won't be able to release them.
+  // Storages are allocated in slabs, which are freed only with the pool, because we don't know
+  // whether a storage is pointed to by some weak pointer
+  std::vector<std::unique_ptr<Storage[]>> slabs_;
+  Storage *slab_next_ = nullptr;
+  Storage *slab_end_ = nullptr;
+
+  Storage *new_slab(size_t n) {
+    slabs_.emplace_back(new Storage[n]);
+    return slabs_.back().get();
+  }
+
   // TODO(perf): memory order
   // TODO(perf): use another non lockfree list for release on the same thread
   // only one thread, so no aba problem
   Storage *get_storage() {
     if (head_.load() == nullptr) {
+      if (slab_next_ == slab_end_) {
+        auto n = td::max(SLAB_SIZE / sizeof(Storage), static_cast<size_t>(1));
+        slab_next_ = new_slab(n);
+        slab_end_ = slab_next_ + n;
+      }
       storage_count_++;
-      return new Storage();
+      return slab_next_++;
     }
     Storage *res;
     while (true) {
@@ -1,76 +1,74 @@
 #pragma once
 
+#include "td/utils/bits.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
+#include "td/utils/Status.h"
 
 #include <utility>
 
 namespace td {
 
 // Process states in order defined by their Id
+// Pending states are stored in a power-of-two ring buffer with a bitmap of present states
 template <class DataT>
 class OrderedEventsProcessor {
  public:
   using SeqNo = uint64;
 
   OrderedEventsProcessor() = default;
-  explicit OrderedEventsProcessor(SeqNo offset) : offset_(offset), begin_(offset_), end_(offset_) {
+  explicit OrderedEventsProcessor(SeqNo offset) : begin_(offset), end_(offset) {
+  }
+  // states with seq_no >= max_finished_seq_no() + 1 + max_window_size are rejected by try_add instead of growing the window
+  OrderedEventsProcessor(SeqNo offset, size_t max_window_size)
+      : begin_(offset), end_(offset), max_window_size_(max_window_size) {
   }
 
   template <class FunctionT>
   void clear(FunctionT &&function) {
-    for (auto &it : data_array_) {
-      if (it.second) {
-        function(std::move(it.first));
+    for (auto seq_no = begin_; seq_no < end_; seq_no++) {
+      auto pos = get_pos(seq_no);
+      if (is_present(pos)) {
+        function(std::move(data_array_[pos]));
       }
     }
-    *this = OrderedEventsProcessor();
+    clear();
   }
   void clear() {
-    *this = OrderedEventsProcessor();
+    *this = OrderedEventsProcessor(1, max_window_size_);
   }
   template <class FromDataT, class FunctionT>
   void add(SeqNo seq_no, FromDataT &&data, FunctionT &&function) {
+    try_add(seq_no, std::forward<FromDataT>(data), std::forward<FunctionT>(function)).ensure();
+  }
+  template <class FromDataT, class FunctionT>
+  TD_WARN_UNUSED_RESULT Status try_add(SeqNo seq_no, FromDataT &&data, FunctionT &&function) {
     LOG_CHECK(seq_no >= begin_) << seq_no << ">=" << begin_;  // or ignore?
 
     if (seq_no == begin_) {  // run now
       begin_++;
       function(seq_no, std::forward<FromDataT>(data));
-
-      while (begin_ < end_) {
-        auto &data_flag = data_array_[static_cast<size_t>(begin_ - offset_)];
-        if (!data_flag.second) {
-          break;
-        }
-        function(begin_, std::move(data_flag.first));
-        data_flag.second = false;
-        begin_++;
-      }
+      run_ready(function);
       if (begin_ > end_) {
         end_ = begin_;
       }
-      if (begin_ == end_) {
-        offset_ = begin_;
-      }
+      return Status::OK();
+    }
 
-      // try_compactify
-      auto begin_pos = static_cast<size_t>(begin_ - offset_);
-      if (begin_pos > 5 && begin_pos * 2 > data_array_.size()) {
-        data_array_.erase(data_array_.begin(), data_array_.begin() + begin_pos);
-        offset_ = begin_;
-      }
-    } else {
-      auto pos = static_cast<size_t>(seq_no - offset_);
-      auto need_size = pos + 1;
-      if (data_array_.size() < need_size) {
-        data_array_.resize(need_size);
-      }
-      data_array_[pos].first = std::forward<FromDataT>(data);
-      data_array_[pos].second = true;
-      if (end_ < seq_no + 1) {
-        end_ = seq_no + 1;
-      }
+    auto distance = seq_no - begin_;
+    if (max_window_size_ != 0 && distance >= max_window_size_) {
+      return Status::Error(PSLICE() << "Sequence number " << seq_no << " is too far from " << begin_);
+    }
+    if (distance >= data_array_.size()) {
+      grow(static_cast<size_t>(distance + 1));
     }
+    auto pos = get_pos(seq_no);
+    data_array_[pos] = std::forward<FromDataT>(data);
+    present_[pos / 64] |= static_cast<uint64>(1) << (pos % 64);
+    if (end_ < seq_no + 1) {
+      end_ = seq_no + 1;
+    }
+    return Status::OK();
   }
 
   bool has_events() const {
@@ -84,10 +82,59 @@ class OrderedEventsProcessor {
   }
 
  private:
-  SeqNo offset_ = 1;
   SeqNo begin_ = 1;
   SeqNo end_ = 1;
-  std::vector<std::pair<DataT, bool>> data_array_;
+  size_t max_window_size_ = 0;
+  std::vector<DataT> data_array_;  // the state with seq_no is stored at position seq_no % data_array_.size()
+  std::vector<uint64> present_;
+
+  size_t get_pos(SeqNo seq_no) const {
+    return static_cast<size_t>(seq_no) & (data_array_.size() - 1);
+  }
+
+  bool is_present(size_t pos) const {
+    return ((present_[pos / 64] >> (pos % 64)) & 1) != 0;
+  }
+
+  // processes all consecutive present states starting from begin_
+  template <class FunctionT>
+  void run_ready(FunctionT &function) {
+    while (begin_ < end_) {
+      auto pos = get_pos(begin_);
+      auto &word = present_[pos / 64];
+      auto bits = word >> (pos % 64);
+      // the run never crosses a word, because the size of the array is a multiple of 64
+      auto run_length = count_trailing_zeroes64(~bits);
+      if (run_length == 0) {
+        break;
+      }
+      auto run_mask = run_length == 64 ? ~static_cast<uint64>(0) : (static_cast<uint64>(1) << run_length) - 1;
+      word &= ~(run_mask << (pos % 64));
+      for (int i = 0; i < run_length; i++) {
+        function(begin_, std::move(data_array_[pos + i]));
+        begin_++;
+      }
+    }
+  }
+
+  void grow(size_t min_size) {
+    size_t new_size = td::max(data_array_.size(), static_cast<size_t>(64));
+    while (new_size < min_size) {
+      new_size *= 2;
+    }
+    std::vector<DataT> new_data_array(new_size);
+    std::vector<uint64> new_present(new_size / 64);
+    for (auto seq_no = begin_; seq_no < end_; seq_no++) {
+      auto pos = get_pos(seq_no);
+      if (is_present(pos)) {
+        auto new_pos = static_cast<size_t>(seq_no) & (new_size - 1);
+        new_data_array[new_pos] = std::move(data_array_[pos]);
+        new_present[new_pos / 64] |= static_cast<uint64>(1) << (new_pos % 64);
+      }
+    }
+    data_array_ = std::move(new_data_array);
+    present_ = std::move(new_present);
+  }
 };
 
 }  // namespace td
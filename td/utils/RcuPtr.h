@@ -0,0 +1,102 @@
+#pragma once
+
+#include "td/utils/common.h"
+#include "td/utils/EpochBasedMemoryReclamation.h"
+
+#include <atomic>
+#include <utility>
+
+namespace td {
+
+// Read-mostly pointer with RCU-like semantics
+// Readers only pin the current epoch and load the pointer, writers publish a new version
+// and retire the old one through EpochBasedMemoryReclamation.
+//
+// Every thread must use its own Locker, obtained once via get_locker(thread_id).
+// ReadGuards of the same Locker must not be nested.
+// A Locker waits for all values retired through it to be freed in its destructor,
+// so it must be destroyed while no other thread holds a ReadGuard for a long time.
+template <class T>
+class RcuPtr {
+ public:
+  using Locker = typename EpochBasedMemoryReclamation<T>::Locker;
+
+  explicit RcuPtr(size_t threads_n, unique_ptr<T> value = nullptr) : ebmr_(threads_n), ptr_(value.release()) {
+  }
+  RcuPtr(const RcuPtr &other) = delete;
+  RcuPtr &operator=(const RcuPtr &other) = delete;
+  RcuPtr(RcuPtr &&other) = delete;
+  RcuPtr &operator=(RcuPtr &&other) = delete;
+  ~RcuPtr() {
+    delete ptr_.load(std::memory_order_relaxed);
+  }
+
+  Locker get_locker(size_t thread_id) {
+    return ebmr_.get_locker(thread_id);
+  }
+
+  // value is guaranteed to be alive while the guard exists
+  class ReadGuard {
+   public:
+    ReadGuard(Locker &locker, const std::atomic<T *> &ptr) : locker_(&locker) {
+      locker_->lock();
+      value_ = ptr.load(std::memory_order_acquire);
+    }
+    ReadGuard(const ReadGuard &other) = delete;
+    ReadGuard &operator=(const ReadGuard &other) = delete;
+    ReadGuard(ReadGuard &&other) : locker_(other.locker_), value_(other.value_) {
+      other.locker_ = nullptr;
+    }
+    ReadGuard &operator=(ReadGuard &&other) = delete;
+    ~ReadGuard() {
+      if (locker_ != nullptr) {
+        locker_->unlock();
+      }
+    }
+
+    const T *get() const {
+      return value_;
+    }
+    const T &operator*() const {
+      return *value_;
+    }
+    const T *operator->() const {
+      return value_;
+    }
+    explicit operator bool() const {
+      return value_ != nullptr;
+    }
+
+   private:
+    Locker *locker_;
+    const T *value_;
+  };
+
+  ReadGuard lock_read(Locker &locker) const {
+    return ReadGuard(locker, ptr_);
+  }
+
+  // publishes the new value and retires the old one
+  // the old value is freed later, once all readers, which could see it, have left their epochs
+  void update(Locker &locker, unique_ptr<T> new_value) {
+    locker.lock();
+    auto *old_value = ptr_.exchange(new_value.release(), std::memory_order_acq_rel);
+    if (old_value != nullptr) {
+      locker.retire(old_value);
+    }
+    locker.retire();
+    locker.unlock();
+  }
+
+  // waits until all values retired through the locker are freed
+  // must not be called while the current thread holds a ReadGuard
+  void retire_sync(Locker &locker) {
+    locker.retire_sync();
+  }
+
+ private:
+  EpochBasedMemoryReclamation<T> ebmr_;
+  std::atomic<T *> ptr_{nullptr};
+};
+
+}  // namespace td
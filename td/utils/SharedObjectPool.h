@@ -3,10 +3,13 @@
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/MpscLinkQueue.h"
+#include "td/utils/port/thread_local.h"
+#include "td/utils/ThreadLocalStorage.h"
 
 #include <atomic>
 #include <memory>
 #include <new>
+#include <type_traits>
 #include <utility>
 
 namespace td {
@@ -165,6 +168,14 @@ class SharedPtr {
 
 }  // namespace detail
 
+// Pool of objects owned by SharedPtr.
+// Objects are allocated from slabs of contiguous memory and are never returned to the heap until the pool is destroyed.
+// Objects released by td::thread threads are cached in a per-thread magazine and are moved to the shared free queue
+// in batches, so releasing threads rarely touch shared memory. Other threads push released objects to the queue directly.
+//
+// alloc, total_size, calc_free_size and for_each must be called from one thread; objects can be released from any thread.
+// Up to MAGAZINE_SIZE - 1 objects can stay cached in each releasing thread, and aren't reused until the thread
+// identifier is reused or the pool is destroyed.
 template <class DataT>
 class SharedObjectPool {
   class Deleter;
@@ -183,7 +194,12 @@ class SharedObjectPool {
     while (free_queue_reader_.read()) {
       free_cnt++;
     }
-    LOG_CHECK(free_cnt == allocated_.size()) << free_cnt << " " << allocated_.size();
+    magazines_.for_each([&free_cnt](Magazine &magazine) {
+      while (magazine.reader.read()) {
+        free_cnt++;
+      }
+    });
+    LOG_CHECK(free_cnt == allocated_size_) << free_cnt << " " << allocated_size_;
   }
 
   template <class... ArgsT>
@@ -193,37 +209,69 @@ class SharedObjectPool {
     return Ptr(raw);
   }
   size_t total_size() const {
-    return allocated_.size();
+    return allocated_size_;
   }
+  // non thread safe, also counts objects cached by other threads
   uint64 calc_free_size() {
     free_queue_.pop_all(free_queue_reader_);
-    return free_queue_reader_.calc_size();
+    uint64 res = free_queue_reader_.calc_size();
+    magazines_.for_each([&res](const Magazine &magazine) { res += magazine.size; });
+    return res;
   }
 
   //non thread safe
   template <class F>
   void for_each(F &&f) {
-    for (auto &raw : allocated_) {
-      if (raw->use_cnt() > 0) {
-        f(raw->data());
-      }
+    for (auto &slab : slabs_) {
+      slab->for_each([&](Raw *raw) {
+        if (raw->use_cnt() > 0) {
+          f(raw->data());
+        }
+      });
     }
   }
 
  private:
   using Raw = typename Ptr::Raw;
+  static constexpr size_t MAGAZINE_SIZE = 64;
+  static constexpr size_t MIN_SLAB_SIZE = 16;
+  static constexpr size_t MAX_SLAB_SIZE = 4096;
+
   Raw *alloc_raw() {
-    free_queue_.pop_all(free_queue_reader_);
+    auto &magazine = magazines_.get();
+    if (magazine.size > 0) {
+      magazine.size--;
+      return magazine.reader.read().get();
+    }
     auto *raw = free_queue_reader_.read().get();
     if (raw) {
       return raw;
     }
-    allocated_.push_back(make_unique<Raw>(deleter()));
-    return allocated_.back().get();
+    free_queue_.pop_all(free_queue_reader_);
+    raw = free_queue_reader_.read().get();
+    if (raw) {
+      return raw;
+    }
+    if (slabs_.empty() || slabs_.back()->is_full()) {
+      auto slab_size = slabs_.empty() ? MIN_SLAB_SIZE : td::min(slabs_.back()->capacity() * 2, MAX_SLAB_SIZE);
+      slabs_.push_back(make_unique<Slab>(slab_size));
+    }
+    allocated_size_++;
+    return slabs_.back()->alloc(deleter());
   }
 
   void free_raw(Raw *raw) {
-    free_queue_.push(Node{raw});
+    if (get_thread_id() == 0) {
+      // threads not created by td::thread share identifier 0, so they can't use a magazine
+      free_queue_.push(Node{raw});
+      return;
+    }
+    auto &magazine = magazines_.get();
+    magazine.reader.delay(Node{raw});
+    if (++magazine.size == MAGAZINE_SIZE) {
+      free_queue_.push_all(magazine.reader);
+      magazine.size = 0;
+    }
   }
 
   class Node {
@@ -266,9 +314,54 @@ class SharedObjectPool {
     return Deleter(this);
   }
 
-  std::vector<unique_ptr<Raw>> allocated_;
+  // Raw objects are constructed in the slab one by one and are destroyed together with it
+  class Slab {
+   public:
+    explicit Slab(size_t capacity) : storage_(new Storage[capacity]), capacity_(capacity) {
+    }
+    Slab(const Slab &other) = delete;
+    Slab &operator=(const Slab &other) = delete;
+    Slab(Slab &&other) = delete;
+    Slab &operator=(Slab &&other) = delete;
+    ~Slab() {
+      for_each([](Raw *raw) { raw->~Raw(); });
+    }
+
+    bool is_full() const {
+      return size_ == capacity_;
+    }
+    size_t capacity() const {
+      return capacity_;
+    }
+    Raw *alloc(Deleter deleter) {
+      CHECK(!is_full());
+      return new (&storage_[size_++]) Raw(std::move(deleter));
+    }
+    template <class F>
+    void for_each(F &&f) {
+      for (size_t i = 0; i < size_; i++) {
+        f(reinterpret_cast<Raw *>(&storage_[i]));
+      }
+    }
+
+   private:
+    using Storage = typename std::aligned_storage<sizeof(Raw), alignof(Raw)>::type;
+    std::unique_ptr<Storage[]> storage_;
+    size_t capacity_;
+    size_t size_{0};
+  };
+
+  // is accessed only by the thread with the corresponding thread identifier
+  struct Magazine {
+    typename MpscLinkQueue<Node>::Reader reader;
+    size_t size{0};
+  };
+
+  std::vector<unique_ptr<Slab>> slabs_;
+  size_t allocated_size_{0};
   MpscLinkQueue<Node> free_queue_;
   typename MpscLinkQueue<Node>::Reader free_queue_reader_;
+  ThreadLocalStorage<Magazine> magazines_;
 };
 
 }  // namespace td
@@ -1,12 +1,65 @@
 #pragma once
 
+#include "td/utils/common.h"
+#include "td/utils/port/Futex.h"
 #include "td/utils/port/thread.h"
 
 #include <atomic>
 #include <memory>
 
+#if TD_MSVC
+#include <intrin.h>
+#endif
+
 namespace td {
 
+namespace detail {
+inline void cpu_relax() {
+#if (TD_GCC || TD_CLANG || TD_INTEL) && (defined(__i386__) || defined(__x86_64__))
+  __builtin_ia32_pause();
+#elif (TD_GCC || TD_CLANG) && defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#elif TD_MSVC && (defined(_M_IX86) || defined(_M_X64))
+  _mm_pause();
+#endif
+}
+
+// Spins with exponentially growing number of pauses, then yields, then asks to park
+class SpinBackoff {
+ public:
+  // returns false when the caller should stop spinning and park
+  bool next() {
+    cnt_++;
+    if (cnt_ <= SpinRounds) {
+      for (int i = 0; i < (1 << cnt_); i++) {
+        cpu_relax();
+      }
+      return true;
+    }
+    if (cnt_ <= SpinRounds + YieldRounds) {
+      td::this_thread::yield();
+      return true;
+    }
+    return false;
+  }
+
+  int get_count() const {
+    return cnt_;
+  }
+
+ private:
+  enum { SpinRounds = 8, YieldRounds = 8 };
+  int cnt_ = 0;
+};
+}  // namespace detail
+
+// Contention counters of a lock. Are updated only on a contended path.
+struct LockStats {
+  std::atomic<uint64> contended{0};
+  std::atomic<uint64> spins{0};
+  std::atomic<uint64> parks{0};
+};
+
 class SpinLock {
   struct Unlock {
     void operator()(SpinLock *ptr) {
@@ -14,40 +67,109 @@ class SpinLock {
     }
   };
 
-  class InfBackoff {
-    int cnt = 0;
-
-   public:
-    bool next() {
-      cnt++;
-      if (cnt < 50) {
-        //TODO pause
-        return true;
-      } else {
-        td::this_thread::yield();
-        return true;
+ public:
+  using Lock = std::unique_ptr<SpinLock, Unlock>;
+
+  Lock lock() {
+    if (!try_lock()) {
+      lock_slow();
+    }
+    return Lock(this);
+  }
+  bool try_lock() {
+    uint32 state = Unlocked;
+    return state_.compare_exchange_strong(state, Locked, std::memory_order_acquire, std::memory_order_relaxed);
+  }
+
+  // stats must outlive the lock
+  void set_stats(LockStats *stats) {
+    stats_ = stats;
+  }
+
+ private:
+  enum : uint32 { Unlocked = 0, Locked = 1, LockedWithWaiters = 2 };
+  std::atomic<uint32> state_{Unlocked};
+  LockStats *stats_{nullptr};
+
+  void unlock() {
+    if (state_.exchange(Unlocked, std::memory_order_release) == LockedWithWaiters) {
+      futex_wake(state_, 1);
+    }
+  }
+
+  void lock_slow() {
+    detail::SpinBackoff backoff;
+    bool is_acquired = false;
+    while (backoff.next()) {
+      if (state_.load(std::memory_order_relaxed) == Unlocked && try_lock()) {
+        is_acquired = true;
+        break;
       }
     }
+    uint64 parks = 0;
+    if (!is_acquired) {
+      // after parking we can't know whether there are other waiters, so unlock must always wake somebody
+      while (state_.exchange(LockedWithWaiters, std::memory_order_acquire) != Unlocked) {
+        parks++;
+        futex_wait(state_, LockedWithWaiters);
+      }
+    }
+    if (stats_ != nullptr) {
+      stats_->contended.fetch_add(1, std::memory_order_relaxed);
+      stats_->spins.fetch_add(backoff.get_count(), std::memory_order_relaxed);
+      stats_->parks.fetch_add(parks, std::memory_order_relaxed);
+    }
+  }
+};
+
+// FIFO spin lock. Waiters are served in order of arrival, so none of them can starve.
+// Waiters never park, so it should be used only for short critical sections.
+class TicketSpinLock {
+  struct Unlock {
+    void operator()(TicketSpinLock *ptr) {
+      ptr->unlock();
+    }
   };
 
  public:
-  using Lock = std::unique_ptr<SpinLock, Unlock>;
+  using Lock = std::unique_ptr<TicketSpinLock, Unlock>;
 
   Lock lock() {
-    InfBackoff backoff;
-    while (!try_lock()) {
-      backoff.next();
+    auto ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+    auto now_serving = now_serving_.load(std::memory_order_acquire);
+    if (now_serving != ticket) {
+      detail::SpinBackoff backoff;
+      do {
+        if (!backoff.next()) {
+          td::this_thread::yield();
+        }
+      } while (now_serving_.load(std::memory_order_acquire) != ticket);
+      if (stats_ != nullptr) {
+        stats_->contended.fetch_add(1, std::memory_order_relaxed);
+        stats_->spins.fetch_add(backoff.get_count(), std::memory_order_relaxed);
+      }
     }
     return Lock(this);
   }
   bool try_lock() {
-    return !flag_.test_and_set(std::memory_order_acquire);
+    auto now_serving = now_serving_.load(std::memory_order_relaxed);
+    auto ticket = now_serving;
+    return next_ticket_.compare_exchange_strong(ticket, now_serving + 1, std::memory_order_acquire,
+                                                std::memory_order_relaxed);
+  }
+
+  // stats must outlive the lock
+  void set_stats(LockStats *stats) {
+    stats_ = stats;
   }
 
  private:
-  std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+  std::atomic<uint32> next_ticket_{0};
+  std::atomic<uint32> now_serving_{0};
+  LockStats *stats_{nullptr};
+
   void unlock() {
-    flag_.clear(std::memory_order_release);
+    now_serving_.store(now_serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
   }
 };
 
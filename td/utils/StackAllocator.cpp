@@ -1,9 +1,128 @@
 #include "td/utils/StackAllocator.h"
 
+#include "td/utils/port/config.h"
 #include "td/utils/port/thread_local.h"
 
+#if TD_PORT_POSIX
+#include <sys/mman.h>
+#endif
+
 namespace td {
 
+namespace {
+
+// a multiple of the page size on all supported platforms; segment sizes and trimmed offsets are aligned to it
+constexpr size_t PAGE_ALIGNMENT = 1 << 16;
+
+size_t align_to_page(size_t size) {
+  return (size + PAGE_ALIGNMENT - 1) & ~(PAGE_ALIGNMENT - 1);
+}
+
+char *map_memory(size_t size) {
+#if TD_PORT_POSIX
+  void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (ptr == MAP_FAILED) {
+    std::abort();  // memory is over
+  }
+#elif TD_PORT_WINDOWS
+  void *ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if (ptr == nullptr) {
+    std::abort();  // memory is over
+  }
+#endif
+  return static_cast<char *>(ptr);
+}
+
+void unmap_memory(char *ptr, size_t size) {
+#if TD_PORT_POSIX
+  munmap(ptr, size);
+#elif TD_PORT_WINDOWS
+  VirtualFree(ptr, 0, MEM_RELEASE);
+#endif
+}
+
+// the memory stays mapped, but its content can be discarded and physical pages can be reused by the OS
+void discard_memory(char *ptr, size_t size) {
+#if TD_PORT_POSIX
+  madvise(ptr, size, MADV_DONTNEED);
+#elif TD_PORT_WINDOWS
+  VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE);
+#endif
+}
+
+}  // namespace
+
+StackAllocator::Impl::Impl() {
+  segments[0].mem = map_memory(FIRST_SEGMENT_SIZE);
+  segments[0].size = FIRST_SEGMENT_SIZE;
+}
+
+StackAllocator::Impl::~Impl() {
+  for (auto &segment : segments) {
+    if (segment.mem != nullptr) {
+      unmap_memory(segment.mem, segment.size);
+    }
+  }
+}
+
+char *StackAllocator::Impl::alloc_slow(size_t size) {
+  // all segments after the current one are empty, so the next segment can be replaced if it is too small
+  current++;
+  if (current == MAX_SEGMENTS) {
+    std::abort();  // memory is over
+  }
+  auto &segment = segments[current];
+  if (segment.size < size) {
+    if (segment.mem != nullptr) {
+      unmap_memory(segment.mem, segment.size);
+    }
+    segment = Segment();
+    segment.size = align_to_page(td::max(segments[current - 1].size * 2, size));
+    segment.mem = map_memory(segment.size);
+  }
+  char *res = segment.mem;
+  segment.pos = size;
+  segment.max_pos = td::max(segment.max_pos, size);
+  return res;
+}
+
+// is called when the allocator is empty after TRIM_PERIOD returns to the empty state;
+// segments, which weren't used since the previous trim, are unmapped, and pages above the high-water mark are discarded
+void StackAllocator::Impl::trim() {
+  empty_count = 0;
+  for (size_t i = MAX_SEGMENTS; i-- > 1;) {
+    auto &segment = segments[i];
+    if (segment.mem == nullptr) {
+      continue;
+    }
+    if (segment.max_pos != 0) {
+      break;
+    }
+    unmap_memory(segment.mem, segment.size);
+    segment = Segment();
+  }
+  for (auto &segment : segments) {
+    if (segment.mem == nullptr) {
+      break;
+    }
+    segment.touched = td::max(segment.touched, segment.max_pos);
+    auto keep_size = align_to_page(segment.max_pos);
+    if (segment.touched > keep_size) {
+      discard_memory(segment.mem + keep_size, segment.touched - keep_size);
+      segment.touched = keep_size;
+    }
+    segment.max_pos = 0;
+  }
+}
+
+size_t StackAllocator::Impl::get_memory_size() const {
+  size_t result = 0;
+  for (auto &segment : segments) {
+    result += segment.size;
+  }
+  return result;
+}
+
 StackAllocator::Impl &StackAllocator::impl() {
   static TD_THREAD_LOCAL StackAllocator::Impl *impl;  // static zero-initialized
   init_thread_local<Impl>(impl);
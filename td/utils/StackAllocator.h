@@ -18,7 +18,6 @@ class StackAllocator {
     }
   };
 
-  // TODO: alloc memory with mmap and unload unused pages
   // memory still can be corrupted, but it is better than explicit free function
   // TODO: use pointer that can't be even copied
   using PtrImpl = std::unique_ptr<char, Deleter>;
@@ -40,30 +39,70 @@ class StackAllocator {
     impl().free_ptr(ptr);
   }
 
+  // Memory is allocated in a chain of mmap-ed segments, each at least twice bigger than the previous one.
+  // Allocations are made from the last used segment, and when it is exhausted, the next segment is used,
+  // so the memory is never moved and is always freed in the reverse order.
+  // Pages above the high-water mark of the last TRIM_PERIOD returns to the empty state are given back to the OS.
   struct Impl {
-    static const size_t MEM_SIZE = 1024 * 1024;
-    std::array<char, MEM_SIZE> mem;
+    static constexpr size_t FIRST_SEGMENT_SIZE = 1024 * 1024;
+    static constexpr size_t MAX_SEGMENTS = 40;
+    static constexpr size_t TRIM_PERIOD = 1 << 14;
+
+    struct Segment {
+      char *mem{nullptr};
+      size_t size{0};
+      size_t pos{0};
+      size_t max_pos{0};  // high-water mark since the last trim
+      size_t touched{0};  // size of the prefix, which may be backed by physical pages
+    };
+    std::array<Segment, MAX_SEGMENTS> segments;
+    size_t current{0};
+    size_t empty_count{0};
+
+    Impl();
+    Impl(const Impl &other) = delete;
+    Impl &operator=(const Impl &other) = delete;
+    Impl(Impl &&other) = delete;
+    Impl &operator=(Impl &&other) = delete;
+    ~Impl();
 
-    size_t pos{0};
     char *alloc(size_t size) {
       if (size == 0) {
         size = 1;
       }
-      char *res = mem.data() + pos;
       size = (size + 7) & -8;
-      pos += size;
-      if (pos > MEM_SIZE) {
-        std::abort();  // memory is over
+      auto &segment = segments[current];
+      if (unlikely(size > segment.size - segment.pos)) {
+        return alloc_slow(size);
+      }
+      char *res = segment.mem + segment.pos;
+      segment.pos += size;
+      if (segment.pos > segment.max_pos) {
+        segment.max_pos = segment.pos;
       }
       return res;
     }
     void free_ptr(char *ptr) {
-      size_t new_pos = ptr - mem.data();
-      if (new_pos >= pos) {
+      auto &segment = segments[current];
+      auto new_pos = static_cast<size_t>(ptr - segment.mem);
+      if (new_pos >= segment.pos) {
         std::abort();  // shouldn't happen
       }
-      pos = new_pos;
+      segment.pos = new_pos;
+      if (new_pos == 0) {
+        // previous segments may be empty if they were too small for the allocation
+        while (current != 0 && segments[current].pos == 0) {
+          current--;
+        }
+        if (current == 0 && segments[0].pos == 0 && ++empty_count == TRIM_PERIOD) {
+          trim();
+        }
+      }
     }
+
+    char *alloc_slow(size_t size);
+    void trim();
+    size_t get_memory_size() const;
   };
 
   static Impl &impl();
@@ -72,6 +111,11 @@ class StackAllocator {
   static Ptr alloc(size_t size) {
     return Ptr(impl().alloc(size), size);
   }
+
+  // returns size of the memory reserved by the allocator of the current thread
+  static size_t get_memory_size() {
+    return impl().get_memory_size();
+  }
 };
 
 }  // namespace td
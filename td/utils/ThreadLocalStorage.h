@@ -0,0 +1,101 @@
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/port/thread_local.h"
+
+#include <atomic>
+#include <memory>
+
+namespace td {
+
+// Per-thread values, indexed by get_thread_id()
+// Values are stored in segments, which are allocated on first access by a thread with an identifier from the segment.
+// Segment k holds FIRST_SEGMENT_SIZE * 2^k values, so any number of threads is supported, and
+// get() of a thread from the first segment is just a TLS read and an index.
+// Values are never destroyed until the storage is destroyed, and are reused by threads with recycled identifiers.
+template <class T>
+class ThreadLocalStorage {
+ public:
+  ThreadLocalStorage() {
+    segments_[0] = new Node[FIRST_SEGMENT_SIZE];
+  }
+  ThreadLocalStorage(const ThreadLocalStorage &other) = delete;
+  ThreadLocalStorage &operator=(const ThreadLocalStorage &other) = delete;
+  ThreadLocalStorage(ThreadLocalStorage &&other) = delete;
+  ThreadLocalStorage &operator=(ThreadLocalStorage &&other) = delete;
+  ~ThreadLocalStorage() {
+    for (auto &segment : segments_) {
+      delete[] segment.load(std::memory_order_relaxed);
+    }
+  }
+
+  T &get() {
+    return get(static_cast<size_t>(get_thread_id()));
+  }
+
+  // for structures with their own thread identifiers
+  T &get(size_t thread_id) {
+    if (likely(thread_id < FIRST_SEGMENT_SIZE)) {
+      return segments_[0].load(std::memory_order_relaxed)[thread_id].value;
+    }
+    return get_slow(thread_id);
+  }
+
+  // visits values of all threads, which have ever accessed the storage, and maybe some other default values
+  template <class F>
+  void for_each(F &&f) {
+    for (size_t i = 0; i < MAX_SEGMENTS; i++) {
+      auto *segment = segments_[i].load(std::memory_order_acquire);
+      if (segment != nullptr) {
+        for (size_t j = 0; j < segment_size(i); j++) {
+          f(segment[j].value);
+        }
+      }
+    }
+  }
+  template <class F>
+  void for_each(F &&f) const {
+    for (size_t i = 0; i < MAX_SEGMENTS; i++) {
+      const auto *segment = segments_[i].load(std::memory_order_acquire);
+      if (segment != nullptr) {
+        for (size_t j = 0; j < segment_size(i); j++) {
+          f(segment[j].value);
+        }
+      }
+    }
+  }
+
+ private:
+  struct Node {
+    T value{};
+    char padding[TD_CONCURRENCY_PAD];
+  };
+  static constexpr size_t FIRST_SEGMENT_SIZE = 64;
+  static constexpr size_t MAX_SEGMENTS = 24;
+  std::atomic<Node *> segments_[MAX_SEGMENTS] = {};
+
+  static constexpr size_t segment_size(size_t segment_id) {
+    return FIRST_SEGMENT_SIZE << segment_id;
+  }
+
+  T &get_slow(size_t thread_id) {
+    // segment k starts at FIRST_SEGMENT_SIZE * (2^k - 1)
+    auto x = static_cast<uint64>(thread_id / FIRST_SEGMENT_SIZE + 1);
+    auto segment_id = static_cast<size_t>(63 - count_leading_zeroes64(x));
+    CHECK(segment_id < MAX_SEGMENTS);
+    auto offset = thread_id - FIRST_SEGMENT_SIZE * ((static_cast<size_t>(1) << segment_id) - 1);
+
+    auto *segment = segments_[segment_id].load(std::memory_order_acquire);
+    if (segment == nullptr) {
+      auto new_segment = std::make_unique<Node[]>(segment_size(segment_id));
+      if (segments_[segment_id].compare_exchange_strong(segment, new_segment.get(), std::memory_order_acq_rel,
+                                                        std::memory_order_acquire)) {
+        segment = new_segment.release();
+      }
+    }
+    return segment[offset].value;
+  }
+};
+
+}  // namespace td
@@ -0,0 +1,135 @@
+#include "td/utils/ThreadPool.h"
+
+#if !TD_THREAD_UNSUPPORTED
+
+#include "td/utils/port/thread_local.h"
+#include "td/utils/Random.h"
+
+namespace td {
+
+namespace {
+TD_THREAD_LOCAL ThreadPool *current_pool;
+TD_THREAD_LOCAL size_t current_worker_id;
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads_n) : injection_queue_(threads_n + 1) {
+  workers_.reserve(threads_n);
+  for (size_t i = 0; i < threads_n; i++) {
+    workers_.push_back(make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threads_n; i++) {
+    workers_[i]->thread = td::thread([this, i] { worker_loop(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  close();
+  for (auto &worker : workers_) {
+    while (auto *task = worker->deque.pop()) {
+      delete task;
+    }
+  }
+}
+
+ThreadPool *ThreadPool::get_current() {
+  return current_pool;
+}
+
+size_t ThreadPool::get_current_worker_id() const {
+  if (current_pool == this) {
+    return current_worker_id;
+  }
+  return external_thread_id();
+}
+
+void ThreadPool::push(unique_ptr<Task> task) {
+  CHECK(task);
+  auto worker_id = get_current_worker_id();
+  if (worker_id != external_thread_id()) {
+    workers_[worker_id]->deque.push(task.release());
+  } else {
+    std::lock_guard<std::mutex> guard(external_mutex_);
+    injection_queue_.push(std::move(task), worker_id);
+  }
+  waiter_.notify();
+}
+
+bool ThreadPool::try_run_task() {
+  auto task = find_task(get_current_worker_id());
+  if (!task) {
+    return false;
+  }
+  task->run();
+  return true;
+}
+
+void ThreadPool::close() {
+  if (is_closed_.exchange(true)) {
+    return;
+  }
+  waiter_.notify();
+  for (auto &worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+unique_ptr<ThreadPool::Task> ThreadPool::find_task(size_t worker_id) {
+  unique_ptr<Task> task;
+  if (worker_id != external_thread_id()) {
+    task.reset(workers_[worker_id]->deque.pop());
+    if (task) {
+      return task;
+    }
+    if (injection_queue_.try_pop(task, worker_id)) {
+      return task;
+    }
+  } else {
+    std::lock_guard<std::mutex> guard(external_mutex_);
+    if (injection_queue_.try_pop(task, worker_id)) {
+      return task;
+    }
+  }
+  return steal_task(worker_id);
+}
+
+unique_ptr<ThreadPool::Task> ThreadPool::steal_task(size_t worker_id) {
+  auto workers_n = workers_.size();
+  if (workers_n == 0) {
+    return nullptr;
+  }
+  auto victim = static_cast<size_t>(Random::fast_uint32()) % workers_n;
+  for (size_t i = 0; i < workers_n; i++, victim = victim + 1 == workers_n ? 0 : victim + 1) {
+    if (victim == worker_id) {
+      continue;
+    }
+    auto *task = workers_[victim]->deque.steal();
+    if (task != nullptr) {
+      return unique_ptr<Task>(task);
+    }
+  }
+  return nullptr;
+}
+
+void ThreadPool::worker_loop(size_t worker_id) {
+  current_pool = this;
+  current_worker_id = worker_id;
+  auto waiter_id = static_cast<uint32>(worker_id);
+  int yields = 0;
+  while (true) {
+    auto task = find_task(worker_id);
+    if (task) {
+      yields = waiter_.stop_wait(yields, waiter_id);
+      task->run();
+      continue;
+    }
+    if (is_closed_.load(std::memory_order_acquire)) {
+      break;
+    }
+    yields = waiter_.wait(yields, waiter_id);
+  }
+  current_pool = nullptr;
+}
+
+}  // namespace td
+
+#endif
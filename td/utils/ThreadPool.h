@@ -0,0 +1,176 @@
+#pragma once
+
+#include "td/utils/port/config.h"
+
+#if !TD_THREAD_UNSUPPORTED
+
+#include "td/utils/ChaseLevDeque.h"
+#include "td/utils/common.h"
+#include "td/utils/MpmcQueue.h"
+#include "td/utils/MpmcWaiter.h"
+#include "td/utils/port/thread.h"
+
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace td {
+
+// Work-stealing thread pool
+// Every worker owns a ChaseLevDeque. Tasks pushed from a worker go to its own deque,
+// tasks pushed from any other thread go to the global injection queue.
+// Idle workers steal from random victims and then park using MpmcWaiter.
+// Tasks which weren't run before the pool is closed are destroyed without running.
+class ThreadPool {
+ public:
+  class Task {
+   public:
+    Task() = default;
+    Task(const Task &other) = delete;
+    Task &operator=(const Task &other) = delete;
+    Task(Task &&other) = delete;
+    Task &operator=(Task &&other) = delete;
+    virtual ~Task() = default;
+
+    virtual void run() = 0;
+  };
+
+  explicit ThreadPool(size_t threads_n);
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+  ThreadPool(ThreadPool &&other) = delete;
+  ThreadPool &operator=(ThreadPool &&other) = delete;
+  ~ThreadPool();
+
+  size_t get_threads_n() const {
+    return workers_.size();
+  }
+
+  void push(unique_ptr<Task> task);
+
+  template <class F>
+  void push_function(F &&f) {
+    push(make_unique<LambdaTask<std::decay_t<F>>>(std::forward<F>(f)));
+  }
+
+  // runs one pending task in the current thread, returns false if no task was found
+  // may be called from any thread, is used to help the pool while waiting for some tasks
+  bool try_run_task();
+
+  // stops all workers and waits for them
+  void close();
+
+  // returns the pool whose worker is the current thread or nullptr
+  static ThreadPool *get_current();
+
+ private:
+  template <class F>
+  class LambdaTask final : public Task {
+   public:
+    template <class FromF>
+    explicit LambdaTask(FromF &&f) : f_(std::forward<FromF>(f)) {
+    }
+    void run() final {
+      f_();
+    }
+
+   private:
+    F f_;
+  };
+
+  struct Worker {
+    ChaseLevDeque<Task *> deque;
+    td::thread thread;
+  };
+
+  vector<unique_ptr<Worker>> workers_;
+  MpmcQueue<unique_ptr<Task>> injection_queue_;
+  std::mutex external_mutex_;  // protects injection_queue_ thread_id for non-worker threads
+  MpmcWaiter waiter_;
+  std::atomic<bool> is_closed_{false};
+
+  size_t external_thread_id() const {
+    return workers_.size();
+  }
+  size_t get_current_worker_id() const;
+
+  unique_ptr<Task> find_task(size_t worker_id);
+  unique_ptr<Task> steal_task(size_t worker_id);
+  void worker_loop(size_t worker_id);
+};
+
+// calls f(i) for every i in [begin, end), splitting the range into chunks of grain_size indices
+// the current thread takes part in the work, so the call is allowed from the pool's own workers
+template <class F>
+void parallel_for(ThreadPool &pool, size_t begin, size_t end, size_t grain_size, F &&f) {
+  if (begin >= end) {
+    return;
+  }
+  if (grain_size == 0) {
+    grain_size = 1;
+  }
+  auto chunks_n = (end - begin + grain_size - 1) / grain_size;
+  std::atomic<size_t> next_chunk{0};
+  auto run_chunks = [&] {
+    while (true) {
+      auto chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunks_n) {
+        break;
+      }
+      auto chunk_begin = begin + chunk * grain_size;
+      auto chunk_end = chunk_begin + min(grain_size, end - chunk_begin);
+      for (auto i = chunk_begin; i < chunk_end; i++) {
+        f(i);
+      }
+    }
+  };
+
+  auto helpers_n = min(chunks_n - 1, pool.get_threads_n());
+  std::atomic<size_t> pending_helpers{helpers_n};
+  for (size_t i = 0; i < helpers_n; i++) {
+    pool.push_function([&] {
+      run_chunks();
+      pending_helpers.fetch_sub(1, std::memory_order_release);
+    });
+  }
+  run_chunks();
+  while (pending_helpers.load(std::memory_order_acquire) != 0) {
+    if (!pool.try_run_task()) {
+      td::this_thread::yield();
+    }
+  }
+}
+
+// returns combine(...combine(combine(init, r_0), r_1)..., r_k), where r_j is f(...f(f(identity, i), i + 1)..., i_end)
+// over the j-th chunk of grain_size indices; chunks are combined in order, so the result doesn't depend
+// on scheduling even if combine is not commutative
+template <class T, class F, class CombineF>
+T parallel_reduce(ThreadPool &pool, size_t begin, size_t end, size_t grain_size, T init, const T &identity, F &&f,
+                  CombineF &&combine) {
+  if (begin >= end) {
+    return init;
+  }
+  if (grain_size == 0) {
+    grain_size = 1;
+  }
+  auto chunks_n = (end - begin + grain_size - 1) / grain_size;
+  vector<T> chunk_results(chunks_n, identity);
+  parallel_for(pool, 0, chunks_n, 1, [&](size_t chunk) {
+    auto chunk_begin = begin + chunk * grain_size;
+    auto chunk_end = chunk_begin + min(grain_size, end - chunk_begin);
+    T result = identity;
+    for (auto i = chunk_begin; i < chunk_end; i++) {
+      result = f(std::move(result), i);
+    }
+    chunk_results[chunk] = std::move(result);
+  });
+  for (auto &result : chunk_results) {
+    init = combine(std::move(init), std::move(result));
+  }
+  return init;
+}
+
+}  // namespace td
+
+#endif
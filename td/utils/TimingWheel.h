@@ -0,0 +1,233 @@
+#pragma once
+
+#include "td/utils/bits.h"
+#include "td/utils/common.h"
+#include "td/utils/List.h"
+
+#include <cmath>
+#include <limits>
+
+namespace td {
+
+// Intrusive node of TimingWheel, similar to HeapNode
+class TimerNode : private ListNode {
+ public:
+  bool in_wheel() const {
+    return !ListNode::empty();
+  }
+
+ private:
+  friend class TimingWheel;
+  uint64 expire_tick_ = 0;
+  uint32 slot_ = 0;
+};
+
+// Hierarchical timing wheel: insert, fix and erase are O(1) regardless of the number of timers.
+// Timeouts are rounded up to the tick duration, so a timer is never expired earlier than requested,
+// but can be expired up to one tick later. Postponed timers are moved to the right slot lazily,
+// so get_wakeup_time can return a time, at which nothing expires.
+// Every timer must be erased from the wheel before destruction.
+class TimingWheel {
+ public:
+  explicit TimingWheel(double tick_duration = 0.001) : tick_duration_(tick_duration) {
+    CHECK(tick_duration > 0);
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+  void insert(double timeout, TimerNode *node) {
+    CHECK(!node->in_wheel());
+    node->expire_tick_ = to_tick(timeout, true);
+    place(node);
+    size_++;
+  }
+
+  void fix(double timeout, TimerNode *node) {
+    CHECK(node->in_wheel());
+    auto expire_tick = to_tick(timeout, true);
+    if (expire_tick >= node->expire_tick_) {
+      // the slot of the node will be processed not later than the new timeout,
+      // and the node will be placed again then, so postponing doesn't touch the lists
+      node->expire_tick_ = expire_tick;
+      return;
+    }
+    unlink(node);
+    node->expire_tick_ = expire_tick;
+    place(node);
+  }
+
+  void erase(TimerNode *node) {
+    CHECK(node->in_wheel());
+    unlink(node);
+    size_--;
+  }
+
+  // returns time, not later than the earliest timeout, when advance must be called next
+  double get_wakeup_time() const {
+    CHECK(!empty());
+    auto tick = next_event_tick();
+    auto result = static_cast<double>(tick) * tick_duration_;
+    // the product can be rounded down, so advance must be able to reach the tick from the returned time
+    while (to_tick(result, false) < tick) {
+      result = std::nextafter(result, std::numeric_limits<double>::infinity());
+    }
+    return result;
+  }
+
+  // expires all timers with timeouts not later than now, calling f(TimerNode *) for each of them
+  // the node is removed from the wheel before the call, and f can change the wheel
+  template <class F>
+  void advance(double now, F &&f) {
+    auto target_tick = to_tick(now, false);
+    while (!empty()) {
+      auto tick = next_event_tick();
+      if (tick > target_tick) {
+        break;
+      }
+      current_tick_ = tick;
+      process_tick(f);
+    }
+    // there are no events before target_tick, so it is safe to skip all ticks till it
+    if (current_tick_ <= target_tick) {
+      current_tick_ = target_tick + 1;
+    }
+  }
+
+ private:
+  static constexpr int LEVEL_BITS = 8;
+  static constexpr int LEVEL_COUNT = 4;
+  static constexpr uint32 SLOT_COUNT = 1 << LEVEL_BITS;
+  static constexpr uint64 SLOT_MASK = SLOT_COUNT - 1;
+  static constexpr int WORD_COUNT = SLOT_COUNT / 64;
+
+  double tick_duration_;
+  uint64 current_tick_ = 0;  // the first unprocessed tick
+  size_t size_ = 0;
+  ListNode slots_[LEVEL_COUNT * SLOT_COUNT];
+  uint64 occupied_[LEVEL_COUNT][WORD_COUNT] = {};
+
+  uint64 to_tick(double time, bool round_up) const {
+    auto ticks = time / tick_duration_;
+    if (!(ticks > 0)) {
+      return 0;
+    }
+    if (ticks >= static_cast<double>(std::numeric_limits<uint64>::max() >> LEVEL_BITS)) {
+      return std::numeric_limits<uint64>::max() >> LEVEL_BITS;
+    }
+    auto result = static_cast<uint64>(ticks);
+    if (round_up && static_cast<double>(result) < ticks) {
+      result++;
+    }
+    return result;
+  }
+
+  static TimerNode *to_timer_node(ListNode *node) {
+    return static_cast<TimerNode *>(node);
+  }
+
+  void set_occupied(uint32 slot) {
+    occupied_[slot / SLOT_COUNT][(slot % SLOT_COUNT) / 64] |= static_cast<uint64>(1) << (slot % 64);
+  }
+  void clear_occupied(uint32 slot) {
+    occupied_[slot / SLOT_COUNT][(slot % SLOT_COUNT) / 64] &= ~(static_cast<uint64>(1) << (slot % 64));
+  }
+
+  // returns the first occupied slot of the level with index not less than from, or -1
+  int find_occupied(int level, uint64 from) const {
+    for (auto word = from / 64; word < WORD_COUNT; word++) {
+      auto bits = occupied_[level][word];
+      if (word == from / 64) {
+        bits &= ~static_cast<uint64>(0) << (from % 64);
+      }
+      if (bits != 0) {
+        return static_cast<int>(word * 64) + count_trailing_zeroes_non_zero64(bits);
+      }
+    }
+    return -1;
+  }
+
+  void place(TimerNode *node) {
+    auto tick = td::max(node->expire_tick_, current_tick_);
+    auto delta = tick - current_tick_;
+    int level = 0;
+    while (level + 1 < LEVEL_COUNT && delta >= (static_cast<uint64>(1) << ((level + 1) * LEVEL_BITS))) {
+      level++;
+    }
+    if (level == LEVEL_COUNT - 1) {
+      // too distant timers are stored in the last slot and are placed again after cascading
+      auto max_delta = (static_cast<uint64>(1) << (LEVEL_COUNT * LEVEL_BITS)) - 1;
+      tick = current_tick_ + td::min(delta, max_delta);
+    }
+    auto slot = static_cast<uint32>(level * SLOT_COUNT + ((tick >> (level * LEVEL_BITS)) & SLOT_MASK));
+    slots_[slot].put_back(node);
+    set_occupied(slot);
+    node->slot_ = slot;
+  }
+
+  void unlink(TimerNode *node) {
+    node->ListNode::remove();
+    if (slots_[node->slot_].empty()) {
+      clear_occupied(node->slot_);
+    }
+  }
+
+  // returns the first tick, at which a timer expires or a slot of a higher level must be cascaded
+  uint64 next_event_tick() const {
+    auto result = std::numeric_limits<uint64>::max();
+    for (int level = 0; level < LEVEL_COUNT; level++) {
+      auto shift = level * LEVEL_BITS;
+      auto block = current_tick_ >> shift;
+      auto index = block & SLOT_MASK;
+      bool is_slot_start = (current_tick_ & ((static_cast<uint64>(1) << shift) - 1)) == 0;
+      auto round = block & ~SLOT_MASK;
+      auto slot = find_occupied(level, is_slot_start ? index : index + 1);
+      if (slot == -1) {
+        slot = find_occupied(level, 0);
+        if (slot == -1) {
+          continue;
+        }
+        round += SLOT_COUNT;
+      }
+      result = td::min(result, (round | static_cast<uint64>(slot)) << shift);
+    }
+    return result;
+  }
+
+  template <class F>
+  void process_tick(F &f) {
+    auto tick = current_tick_;
+    for (int level = LEVEL_COUNT - 1; level > 0; level--) {
+      auto shift = level * LEVEL_BITS;
+      if ((tick & ((static_cast<uint64>(1) << shift) - 1)) == 0) {
+        auto slot = static_cast<uint32>(level * SLOT_COUNT + ((tick >> shift) & SLOT_MASK));
+        ListNode cascaded(std::move(slots_[slot]));
+        clear_occupied(slot);
+        while (auto node = cascaded.get()) {
+          place(to_timer_node(node));
+        }
+      }
+    }
+
+    auto slot = static_cast<uint32>(tick & SLOT_MASK);
+    ListNode expired(std::move(slots_[slot]));
+    clear_occupied(slot);
+    current_tick_ = tick + 1;
+    while (auto list_node = expired.get()) {
+      auto node = to_timer_node(list_node);
+      if (node->expire_tick_ > tick) {
+        // the timeout was postponed
+        place(node);
+        continue;
+      }
+      size_--;
+      f(node);
+    }
+  }
+};
+
+}  // namespace td
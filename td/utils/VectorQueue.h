@@ -1,65 +1,134 @@
 #pragma once
 
+#include "td/utils/common.h"
 #include "td/utils/Span.h"
 
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <utility>
-#include <vector>
 
 namespace td {
 
+// FIFO queue over a power-of-two ring buffer. Elements are never moved on pop.
+// Elements of the queue are stored contiguously unless the queue wraps around the end of the buffer,
+// so as_span() and as_mutable_span() return the longest contiguous prefix of the queue,
+// which is non-empty if the queue is non-empty
 template <class T>
 class VectorQueue {
  public:
+  VectorQueue() = default;
+  VectorQueue(const VectorQueue &) = delete;
+  VectorQueue &operator=(const VectorQueue &) = delete;
+  VectorQueue(VectorQueue &&other) noexcept
+      : storage_(std::move(other.storage_)), capacity_(other.capacity_), head_(other.head_), size_(other.size_) {
+    other.capacity_ = 0;
+    other.head_ = 0;
+    other.size_ = 0;
+  }
+  VectorQueue &operator=(VectorQueue &&other) noexcept {
+    if (this != &other) {
+      clear();
+      storage_ = std::move(other.storage_);
+      capacity_ = other.capacity_;
+      head_ = other.head_;
+      size_ = other.size_;
+      other.capacity_ = 0;
+      other.head_ = 0;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+  ~VectorQueue() {
+    clear();
+  }
+
   template <class S>
   void push(S &&s) {
-    vector_.push_back(std::forward<S>(s));
+    emplace(std::forward<S>(s));
   }
   template <class... Args>
   void emplace(Args &&... args) {
-    vector_.emplace_back(std::forward<Args>(args)...);
+    if (size_ == capacity_) {
+      grow();
+    }
+    new (&at(size_)) T(std::forward<Args>(args)...);
+    size_++;
   }
   T pop() {
-    try_shrink();
-    return std::move(vector_[read_pos_++]);
+    T result = std::move(front());
+    pop_n(1);
+    return result;
   }
+  // O(n) only if T has a non-trivial destructor
   void pop_n(size_t n) {
-    read_pos_ += n;
-    try_shrink();
+    CHECK(n <= size_);
+    if (!std::is_trivially_destructible<T>::value) {
+      for (size_t i = 0; i < n; i++) {
+        at(i).~T();
+      }
+    }
+    size_ -= n;
+    // an empty queue is restarted from the beginning of the buffer to keep it contiguous
+    head_ = size_ == 0 ? 0 : (head_ + n) & (capacity_ - 1);
   }
   T &front() {
-    return vector_[read_pos_];
+    return at(0);
   }
   T &back() {
-    return vector_.back();
+    return at(size_ - 1);
   }
   bool empty() const {
     return size() == 0;
   }
   size_t size() const {
-    return vector_.size() - read_pos_;
+    return size_;
   }
   T *data() {
-    return vector_.data() + read_pos_;
+    return capacity_ == 0 ? nullptr : &at(0);
   }
   const T *data() const {
-    return vector_.data() + read_pos_;
+    return capacity_ == 0 ? nullptr : &at(0);
   }
   Span<T> as_span() const {
-    return {data(), size()};
+    return {data(), contiguous_size()};
   }
   MutableSpan<T> as_mutable_span() {
-    return {data(), size()};
+    return {data(), contiguous_size()};
+  }
+
+  void clear() {
+    pop_n(size_);
   }
 
  private:
-  std::vector<T> vector_;
-  size_t read_pos_{0};
+  using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+  std::unique_ptr<Storage[]> storage_;
+  size_t capacity_{0};
+  size_t head_{0};
+  size_t size_{0};
+
+  T &at(size_t i) {
+    return *reinterpret_cast<T *>(&storage_[(head_ + i) & (capacity_ - 1)]);
+  }
+  const T &at(size_t i) const {
+    return *reinterpret_cast<const T *>(&storage_[(head_ + i) & (capacity_ - 1)]);
+  }
+
+  size_t contiguous_size() const {
+    return td::min(size_, capacity_ - head_);
+  }
 
-  void try_shrink() {
-    if (read_pos_ * 2 > vector_.size() && read_pos_ > 4) {
-      vector_.erase(vector_.begin(), vector_.begin() + read_pos_);
-      read_pos_ = 0;
+  void grow() {
+    size_t new_capacity = capacity_ == 0 ? 8 : capacity_ * 2;
+    auto new_storage = std::make_unique<Storage[]>(new_capacity);
+    for (size_t i = 0; i < size_; i++) {
+      new (&new_storage[i]) T(std::move(at(i)));
+      at(i).~T();
     }
+    storage_ = std::move(new_storage);
+    capacity_ = new_capacity;
+    head_ = 0;
   }
 };
 
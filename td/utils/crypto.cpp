@@ -1,9 +1,9 @@
 #include "td/utils/crypto.h"
 
 #include "td/utils/BigNum.h"
+#include "td/utils/DistributedRwMutex.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
-#include "td/utils/port/RwMutex.h"
 #include "td/utils/port/thread_local.h"
 #include "td/utils/Random.h"
 #include "td/utils/ScopeGuard.h"
@@ -590,8 +590,8 @@ Result<BufferSlice> rsa_decrypt_pkcs1_oaep(Slice private_key, Slice data) {
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
 namespace {
-std::vector<RwMutex> &openssl_mutexes() {
-  static std::vector<RwMutex> mutexes(CRYPTO_num_locks());
+std::vector<DistributedRwMutex> &openssl_mutexes() {
+  static std::vector<DistributedRwMutex> mutexes(CRYPTO_num_locks());
   return mutexes;
 }
 
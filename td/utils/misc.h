@@ -1,5 +1,6 @@
 #pragma once
 
+#include "td/utils/Arena.h"
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
@@ -26,23 +27,39 @@ std::pair<T, T> split(T s, char delimiter = ' ') {
   }
 }
 
-template <class T>
-vector<T> full_split(T s, char delimiter = ' ') {
-  vector<T> result;
+namespace detail {
+template <class T, class VectorT>
+void full_split_to(T s, char delimiter, VectorT &result) {
   if (s.empty()) {
-    return result;
+    return;
   }
   while (true) {
     auto delimiter_pos = s.find(delimiter);
     if (delimiter_pos == string::npos) {
       result.push_back(std::move(s));
-      return result;
+      return;
     } else {
       result.push_back(s.substr(0, delimiter_pos));
       s = s.substr(delimiter_pos + 1);
     }
   }
 }
+}  // namespace detail
+
+template <class T>
+vector<T> full_split(T s, char delimiter = ' ') {
+  vector<T> result;
+  detail::full_split_to(std::move(s), delimiter, result);
+  return result;
+}
+
+// the result is allocated in the arena, so splitting of a Slice doesn't allocate memory in a steady state
+template <class T>
+ArenaVector<T> full_split(T s, char delimiter, Arena &arena) {
+  ArenaVector<T> result{ArenaAllocator<T>(arena)};
+  detail::full_split_to(std::move(s), delimiter, result);
+  return result;
+}
 
 string implode(const vector<string> &v, char delimiter = ' ');
 
@@ -0,0 +1,163 @@
+#include "td/utils/port/CpuTopology.h"
+
+#include "td/utils/misc.h"
+#include "td/utils/port/FileFd.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace td {
+
+size_t CpuTopology::get_physical_core_count() const {
+  vector<std::pair<int32, int32>> cores;
+  for (auto &cpu : cpus) {
+    cores.emplace_back(cpu.package_id, cpu.core_id);
+  }
+  std::sort(cores.begin(), cores.end());
+  return std::unique(cores.begin(), cores.end()) - cores.begin();
+}
+
+vector<int32> CpuTopology::get_numa_nodes() const {
+  vector<int32> result;
+  for (auto &cpu : cpus) {
+    result.push_back(cpu.numa_node);
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+vector<int32> CpuTopology::get_numa_node_cpus(int32 numa_node) const {
+  vector<int32> result;
+  for (auto &cpu : cpus) {
+    if (cpu.numa_node == numa_node) {
+      result.push_back(cpu.id);
+    }
+  }
+  return result;
+}
+
+vector<int32> CpuTopology::get_spread_order() const {
+  // siblings of every physical core, grouped by NUMA node
+  std::map<int32, std::map<std::pair<int32, int32>, vector<int32>>> nodes;
+  for (auto &cpu : cpus) {
+    nodes[cpu.numa_node][std::make_pair(cpu.package_id, cpu.core_id)].push_back(cpu.id);
+  }
+
+  // (sibling index, core index within the node, node) -> cpu
+  vector<std::tuple<size_t, size_t, int32, int32>> order;
+  for (auto &node : nodes) {
+    size_t core_pos = 0;
+    for (auto &core : node.second) {
+      for (size_t i = 0; i < core.second.size(); i++) {
+        order.emplace_back(i, core_pos, node.first, core.second[i]);
+      }
+      core_pos++;
+    }
+  }
+  std::sort(order.begin(), order.end());
+
+  vector<int32> result;
+  for (auto &it : order) {
+    result.push_back(std::get<3>(it));
+  }
+  return result;
+}
+
+Result<vector<int32>> parse_cpu_list(Slice str) {
+  vector<int32> result;
+  for (auto range : full_split(trim(str), ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    auto bounds = split(range, '-');
+    TRY_RESULT(begin, to_integer_safe<int32>(bounds.first));
+    auto end = begin;
+    if (!bounds.second.empty()) {
+      TRY_RESULT(range_end, to_integer_safe<int32>(bounds.second));
+      end = range_end;
+    }
+    if (begin < 0 || end < begin) {
+      return Status::Error(PSLICE() << "Invalid CPU range \"" << range << '"');
+    }
+    for (auto cpu = begin; cpu <= end; cpu++) {
+      result.push_back(cpu);
+    }
+  }
+  return std::move(result);
+}
+
+#if TD_LINUX || TD_ANDROID
+// files in sysfs report wrong size, so read_file can't be used
+static Result<string> read_sys_file(CSlice path) {
+  TRY_RESULT(fd, FileFd::open(path, FileFd::Read));
+  string result;
+  char buf[1024];
+  while (true) {
+    TRY_RESULT(size, fd.read(MutableSlice(buf, sizeof(buf))));
+    if (size == 0) {
+      break;
+    }
+    result.append(buf, size);
+  }
+  fd.close();
+  return std::move(result);
+}
+
+static Result<int32> read_sys_integer(CSlice path) {
+  TRY_RESULT(str, read_sys_file(path));
+  return to_integer_safe<int32>(trim(Slice(str)));
+}
+#endif
+
+Result<CpuTopology> get_cpu_topology() {
+  CpuTopology topology;
+#if TD_LINUX || TD_ANDROID
+  TRY_RESULT(online, read_sys_file("/sys/devices/system/cpu/online"));
+  TRY_RESULT(cpu_ids, parse_cpu_list(online));
+  for (auto cpu_id : cpu_ids) {
+    CpuTopology::Cpu cpu;
+    cpu.id = cpu_id;
+    string prefix = PSTRING() << "/sys/devices/system/cpu/cpu" << cpu_id << "/topology/";
+    // topology may be unavailable, for example, in containers
+    auto r_core_id = read_sys_integer(prefix + "core_id");
+    cpu.core_id = r_core_id.is_ok() ? r_core_id.ok() : cpu_id;
+    auto r_package_id = read_sys_integer(prefix + "physical_package_id");
+    cpu.package_id = r_package_id.is_ok() ? r_package_id.ok() : 0;
+    topology.cpus.push_back(cpu);
+  }
+
+  auto r_nodes = read_sys_file("/sys/devices/system/node/online");
+  if (r_nodes.is_ok()) {
+    TRY_RESULT(nodes, parse_cpu_list(r_nodes.ok()));
+    for (auto node : nodes) {
+      auto r_node_cpus = read_sys_file(PSLICE() << "/sys/devices/system/node/node" << node << "/cpulist");
+      if (r_node_cpus.is_error()) {
+        continue;
+      }
+      TRY_RESULT(node_cpus, parse_cpu_list(r_node_cpus.ok()));
+      for (auto node_cpu : node_cpus) {
+        for (auto &cpu : topology.cpus) {
+          if (cpu.id == node_cpu) {
+            cpu.numa_node = node;
+          }
+        }
+      }
+    }
+  }
+#else
+  auto cpus_n = static_cast<int32>(std::thread::hardware_concurrency());
+  for (int32 i = 0; i < td::max(cpus_n, 1); i++) {
+    CpuTopology::Cpu cpu;
+    cpu.id = i;
+    cpu.core_id = i;
+    topology.cpus.push_back(cpu);
+  }
+#endif
+  return std::move(topology);
+}
+
+}  // namespace td
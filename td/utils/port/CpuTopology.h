@@ -0,0 +1,40 @@
+#pragma once
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Slice.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// Topology of online logical CPUs
+struct CpuTopology {
+  struct Cpu {
+    int32 id = 0;
+    int32 core_id = 0;  // unique only within a package
+    int32 package_id = 0;
+    int32 numa_node = 0;
+  };
+  // sorted by id
+  vector<Cpu> cpus;
+
+  size_t get_physical_core_count() const;
+
+  vector<int32> get_numa_nodes() const;
+
+  vector<int32> get_numa_node_cpus(int32 numa_node) const;
+
+  // Returns all CPUs ordered so that one CPU of every physical core, interleaved between NUMA nodes, goes first,
+  // followed by their hyper-threading siblings. Workers pinned to CPUs in this order are spread across physical cores
+  vector<int32> get_spread_order() const;
+};
+
+// Reads the topology from /sys/devices/system on Linux.
+// On other systems returns every of std::thread::hardware_concurrency() CPUs as a separate core of NUMA node 0
+Result<CpuTopology> get_cpu_topology();
+
+// Parses CPU list in the kernel format, for example "0-3,8,10-11"
+Result<vector<int32>> parse_cpu_list(Slice str);
+
+}  // namespace td
@@ -0,0 +1,35 @@
+#include "td/utils/port/Futex.h"
+
+#include "td/utils/port/thread.h"
+
+#if TD_LINUX || TD_ANDROID
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace td {
+
+#if TD_LINUX || TD_ANDROID
+static_assert(sizeof(std::atomic<uint32>) == sizeof(int), "Unsupported atomic layout");
+
+void futex_wait(std::atomic<uint32> &value, uint32 expected) {
+  syscall(SYS_futex, reinterpret_cast<int *>(&value), FUTEX_WAIT_PRIVATE, static_cast<int>(expected), nullptr,
+          nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32> &value, int32 count) {
+  syscall(SYS_futex, reinterpret_cast<int *>(&value), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+#else
+void futex_wait(std::atomic<uint32> &value, uint32 expected) {
+  if (value.load(std::memory_order_relaxed) == expected) {
+    td::this_thread::yield();
+  }
+}
+
+void futex_wake(std::atomic<uint32> &value, int32 count) {
+}
+#endif
+
+}  // namespace td
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/common.h"
+
+#include <atomic>
+
+namespace td {
+
+// Blocks the current thread while value == expected or until it is woken up by futex_wake.
+// Spurious wakeups are possible. On platforms without futexes just yields.
+void futex_wait(std::atomic<uint32> &value, uint32 expected);
+
+// Wakes up to count threads blocked in futex_wait on the value.
+void futex_wake(std::atomic<uint32> &value, int32 count);
+
+}  // namespace td
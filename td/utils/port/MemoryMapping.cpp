@@ -17,6 +17,15 @@ namespace detail {
 class MemoryMappingImpl {
  public:
   MemoryMappingImpl(MutableSlice data, int64 offset) : data_(data), offset_(offset) {
+  }
+  MemoryMappingImpl(const MemoryMappingImpl &other) = delete;
+  MemoryMappingImpl &operator=(const MemoryMappingImpl &other) = delete;
+  MemoryMappingImpl(MemoryMappingImpl &&other) = delete;
+  MemoryMappingImpl &operator=(MemoryMappingImpl &&other) = delete;
+  ~MemoryMappingImpl() {
+#if !TD_WINDOWS
+    munmap(data_.data(), data_.size());
+#endif
   }
   Slice as_slice() const {
     return data_.substr(narrow_cast<size_t>(offset_));
@@ -67,7 +76,7 @@ Result<MemoryMapping> MemoryMapping::create_from_file(const FileFd &file_fd, con
   if (options.size < 0) {
     end = stat.size_;
   } else {
-    end = begin + stat.size_;
+    end = begin + options.size;
   }
 
   TRY_RESULT(page_size, detail::get_page_size());
@@ -0,0 +1,157 @@
+#include "td/utils/port/ThreadOptions.h"
+
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/Slice.h"
+
+#if TD_PORT_POSIX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if TD_LINUX || TD_ANDROID
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace td {
+
+static Status set_current_thread_affinity(const vector<int32> &cpu_set) {
+  if (cpu_set.empty()) {
+    return Status::OK();
+  }
+#if TD_LINUX || TD_ANDROID
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpu_set) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return Status::Error(PSLICE() << "Invalid CPU " << cpu);
+    }
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    return OS_ERROR("Failed to set thread affinity");
+  }
+  return Status::OK();
+#elif TD_PORT_WINDOWS
+  DWORD_PTR mask = 0;
+  for (auto cpu : cpu_set) {
+    if (cpu < 0 || static_cast<size_t>(cpu) >= sizeof(mask) * 8) {
+      return Status::Error(PSLICE() << "Invalid CPU " << cpu);
+    }
+    mask |= static_cast<DWORD_PTR>(1) << cpu;
+  }
+  if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+    return OS_ERROR("Failed to set thread affinity");
+  }
+  return Status::OK();
+#else
+  return Status::Error("Thread affinity is not supported");
+#endif
+}
+
+static Status set_current_thread_scheduling_policy(ThreadOptions::SchedulingPolicy scheduling_policy,
+                                                   int32 priority) {
+  if (scheduling_policy == ThreadOptions::SchedulingPolicy::Default) {
+    return Status::OK();
+  }
+#if TD_PORT_POSIX
+  int policy = 0;
+  switch (scheduling_policy) {
+    case ThreadOptions::SchedulingPolicy::Fifo:
+      policy = SCHED_FIFO;
+      break;
+    case ThreadOptions::SchedulingPolicy::RoundRobin:
+      policy = SCHED_RR;
+      break;
+#if TD_LINUX || TD_ANDROID
+    case ThreadOptions::SchedulingPolicy::Batch:
+      policy = SCHED_BATCH;
+      priority = 0;
+      break;
+    case ThreadOptions::SchedulingPolicy::Idle:
+      policy = SCHED_IDLE;
+      priority = 0;
+      break;
+#endif
+    default:
+      return Status::Error("Scheduling policy is not supported");
+  }
+  if (policy == SCHED_FIFO || policy == SCHED_RR) {
+    auto min_priority = sched_get_priority_min(policy);
+    auto max_priority = sched_get_priority_max(policy);
+    if (min_priority == -1 || max_priority == -1) {
+      return OS_ERROR("Failed to get thread priority range");
+    }
+    priority = clamp(priority, static_cast<int32>(min_priority), static_cast<int32>(max_priority));
+  }
+  sched_param param;
+  param.sched_priority = priority;
+  auto err = pthread_setschedparam(pthread_self(), policy, &param);
+  if (err != 0) {
+    return Status::PosixError(err, "Failed to set thread scheduling policy");
+  }
+  return Status::OK();
+#elif TD_PORT_WINDOWS
+  int thread_priority = 0;
+  switch (scheduling_policy) {
+    case ThreadOptions::SchedulingPolicy::Fifo:
+    case ThreadOptions::SchedulingPolicy::RoundRobin:
+      thread_priority = THREAD_PRIORITY_TIME_CRITICAL;
+      break;
+    case ThreadOptions::SchedulingPolicy::Batch:
+      thread_priority = THREAD_PRIORITY_BELOW_NORMAL;
+      break;
+    case ThreadOptions::SchedulingPolicy::Idle:
+      thread_priority = THREAD_PRIORITY_IDLE;
+      break;
+    default:
+      UNREACHABLE();
+  }
+  if (!SetThreadPriority(GetCurrentThread(), thread_priority)) {
+    return OS_ERROR("Failed to set thread priority");
+  }
+  return Status::OK();
+#endif
+}
+
+static Status set_current_thread_numa_node(int32 numa_node) {
+  if (numa_node < 0) {
+    return Status::OK();
+  }
+#if (TD_LINUX || TD_ANDROID) && defined(SYS_set_mempolicy)
+  constexpr int32 MAX_NUMA_NODES = 1024;
+  constexpr size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+  if (numa_node >= MAX_NUMA_NODES) {
+    return Status::Error(PSLICE() << "Invalid NUMA node " << numa_node);
+  }
+  unsigned long node_mask[MAX_NUMA_NODES / BITS_PER_WORD] = {};
+  node_mask[numa_node / BITS_PER_WORD] |= 1ul << (numa_node % BITS_PER_WORD);
+  // the kernel expects number of bits in the mask plus one
+  if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, node_mask, MAX_NUMA_NODES + 1) != 0) {
+    return OS_ERROR("Failed to set thread memory policy");
+  }
+  return Status::OK();
+#else
+  return Status::Error("NUMA memory policy is not supported");
+#endif
+}
+
+Status set_current_thread_options(const ThreadOptions &options) {
+  TRY_STATUS(set_current_thread_affinity(options.cpu_set));
+  TRY_STATUS(set_current_thread_scheduling_policy(options.scheduling_policy, options.priority));
+  TRY_STATUS(set_current_thread_numa_node(options.numa_node));
+  return Status::OK();
+}
+
+namespace detail {
+void init_thread_options(const ThreadOptions &options) {
+  auto status = set_current_thread_options(options);
+  if (status.is_error()) {
+    LOG(ERROR) << "Failed to apply thread options: " << status;
+  }
+}
+}  // namespace detail
+
+}  // namespace td
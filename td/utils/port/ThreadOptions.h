@@ -0,0 +1,37 @@
+#pragma once
+
+#include "td/utils/port/config.h"
+
+#include "td/utils/common.h"
+#include "td/utils/Status.h"
+
+namespace td {
+
+// Options of a new td::thread. Default values leave the corresponding property inherited from the creator.
+struct ThreadOptions {
+  enum class SchedulingPolicy : int32 { Default, Fifo, RoundRobin, Batch, Idle };
+
+  // logical CPUs the thread is allowed to run on; use CpuTopology to choose them
+  vector<int32> cpu_set;
+
+  // stack size in bytes, 0 means the default stack size; is ignored if the thread is created through std::thread
+  size_t stack_size = 0;
+
+  SchedulingPolicy scheduling_policy = SchedulingPolicy::Default;
+  // static priority, used only with Fifo and RoundRobin policies; it is clamped to the range supported by the policy,
+  // so the default value 0 means the lowest real-time priority
+  int32 priority = 0;
+
+  // NUMA node, from which memory of the thread should be preferably allocated, -1 means no preference
+  int32 numa_node = -1;
+};
+
+// Applies all options except stack size to the current thread
+Status set_current_thread_options(const ThreadOptions &options) TD_WARN_UNUSED_RESULT;
+
+namespace detail {
+// Called by td::thread at the start of a new thread. Failures are logged, but don't prevent thread from running
+void init_thread_options(const ThreadOptions &options);
+}  // namespace detail
+
+}  // namespace td
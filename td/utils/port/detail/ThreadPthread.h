@@ -10,12 +10,14 @@
 #include "td/utils/MovableValue.h"
 #include "td/utils/port/detail/ThreadIdGuard.h"
 #include "td/utils/port/thread_local.h"
+#include "td/utils/port/ThreadOptions.h"
 #include "td/utils/Slice.h"
 
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
+#include <limits.h>
 #include <pthread.h>
 #include <sched.h>
 
@@ -33,7 +35,8 @@ class ThreadPthread {
     thread_ = other.thread_;
     return *this;
   }
-  template <class Function, class... Args>
+  template <class Function, class... Args,
+            class = std::enable_if_t<!std::is_same<std::decay_t<Function>, ThreadOptions>::value>>
   explicit ThreadPthread(Function &&f, Args &&... args) {
     auto func = create_destructor([args = std::make_tuple(decay_copy(std::forward<Function>(f)),
                                                           decay_copy(std::forward<Args>(args))...)]() mutable {
@@ -43,6 +46,25 @@ class ThreadPthread {
     pthread_create(&thread_, nullptr, run_thread, func.release());
     is_inited_ = true;
   }
+  template <class Function, class... Args>
+  ThreadPthread(ThreadOptions options, Function &&f, Args &&... args) {
+    auto stack_size = options.stack_size;
+    auto func = create_destructor([options = std::move(options),
+                                   args = std::make_tuple(decay_copy(std::forward<Function>(f)),
+                                                          decay_copy(std::forward<Args>(args))...)]() mutable {
+      init_thread_options(options);
+      invoke_tuple(std::move(args));
+      clear_thread_locals();
+    });
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack_size != 0) {
+      pthread_attr_setstacksize(&attr, td::max(stack_size, static_cast<size_t>(PTHREAD_STACK_MIN)));
+    }
+    pthread_create(&thread_, &attr, run_thread, func.release());
+    pthread_attr_destroy(&attr);
+    is_inited_ = true;
+  }
   void set_name(CSlice name) {
 #if defined(_GNU_SOURCE) && defined(__GLIBC_PREREQ)
 #if __GLIBC_PREREQ(2, 12)
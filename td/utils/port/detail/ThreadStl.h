@@ -8,6 +8,7 @@
 #include "td/utils/invoke.h"
 #include "td/utils/port/detail/ThreadIdGuard.h"
 #include "td/utils/port/thread_local.h"
+#include "td/utils/port/ThreadOptions.h"
 #include "td/utils/Slice.h"
 
 #include <thread>
@@ -25,7 +26,8 @@ class ThreadStl {
   ThreadStl(ThreadStl &&) = default;
   ThreadStl &operator=(ThreadStl &&) = default;
   ~ThreadStl() = default;
-  template <class Function, class... Args>
+  template <class Function, class... Args,
+            class = std::enable_if_t<!std::is_same<std::decay_t<Function>, ThreadOptions>::value>>
   explicit ThreadStl(Function &&f, Args &&... args) {
     thread_ = std::thread([args = std::make_tuple(decay_copy(std::forward<Function>(f)),
                                                   decay_copy(std::forward<Args>(args))...)]() mutable {
@@ -34,6 +36,18 @@ class ThreadStl {
       clear_thread_locals();
     });
   }
+  // stack size can't be changed for std::thread and is ignored
+  template <class Function, class... Args>
+  ThreadStl(ThreadOptions options, Function &&f, Args &&... args) {
+    thread_ = std::thread([options = std::move(options),
+                           args = std::make_tuple(decay_copy(std::forward<Function>(f)),
+                                                  decay_copy(std::forward<Args>(args))...)]() mutable {
+      ThreadIdGuard thread_id_guard;
+      init_thread_options(options);
+      invoke_tuple(std::move(args));
+      clear_thread_locals();
+    });
+  }
 
   void join() {
     thread_.join();
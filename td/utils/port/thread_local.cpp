@@ -4,7 +4,7 @@ namespace td {
 
 namespace detail {
 
-static TD_THREAD_LOCAL int32 thread_id_;
+TD_THREAD_LOCAL int32 thread_id_;
 static TD_THREAD_LOCAL std::vector<unique_ptr<Destructor>> *thread_local_destructors;
 
 void add_thread_local_destructor(unique_ptr<Destructor> destructor) {
@@ -28,8 +28,4 @@ void set_thread_id(int32 id) {
   detail::thread_id_ = id;
 }
 
-int32 get_thread_id() {
-  return detail::thread_id_;
-}
-
 }  // namespace td
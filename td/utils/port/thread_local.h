@@ -28,9 +28,16 @@ bool init_thread_local(P &raw_ptr, ArgsT &&... args);
 // Destroy all thread locals, and store nullptr into corresponding pointers
 void clear_thread_locals();
 
+namespace detail {
+extern TD_THREAD_LOCAL int32 thread_id_;
+}  // namespace detail
+
 void set_thread_id(int32 id);
 
-int32 get_thread_id();
+// identifiers are dense and are reused after thread exit, so they can be used as indices in per-thread arrays
+inline int32 get_thread_id() {
+  return detail::thread_id_;
+}
 
 namespace detail {
 void add_thread_local_destructor(unique_ptr<Destructor> destructor);
@@ -0,0 +1,163 @@
+#include "td/utils/Arena.h"
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/StringBuilder.h"
+#include "td/utils/tests.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <utility>
+
+TEST(Arena, allocate) {
+  td::Arena arena(64);
+  std::vector<std::pair<char *, size_t>> allocations;
+  for (int i = 0; i < 10000; i++) {
+    auto size = static_cast<size_t>(td::Random::fast(0, td::Random::fast(0, 1) == 0 ? 10 : 10000));
+    size_t alignment = static_cast<size_t>(1) << td::Random::fast(0, 3);
+    auto ptr = static_cast<char *>(arena.allocate(size, alignment));
+    CHECK(reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0);
+    std::memset(ptr, static_cast<char>(i), size);
+    allocations.emplace_back(ptr, size);
+  }
+  for (size_t i = 0; i < allocations.size(); i++) {
+    for (size_t j = 0; j < allocations[i].second; j++) {
+      CHECK(allocations[i].first[j] == static_cast<char>(i));
+    }
+  }
+
+  auto copy = arena.copy("abacaba");
+  CHECK(copy == "abacaba");
+  auto *x = arena.create<std::pair<int, double>>(1, 2.5);
+  CHECK(x->first == 1 && x->second == 2.5);
+}
+
+TEST(Arena, rewind) {
+  td::Arena arena;
+  auto marker = arena.get_marker();
+  size_t memory_size = 0;
+  for (int i = 0; i < 100; i++) {
+    {
+      td::ArenaScope scope(arena);
+      for (int j = 0; j < 1000; j++) {
+        arena.allocate(100);
+      }
+      auto inner_marker = arena.get_marker();
+      auto ptr = arena.allocate(10);
+      arena.rewind(inner_marker);
+      CHECK(arena.allocate(10) == ptr);
+    }
+    auto end_marker = arena.get_marker();
+    CHECK(end_marker.block == marker.block && end_marker.pos == marker.pos);
+    if (i == 0) {
+      memory_size = arena.get_memory_size();
+    }
+    // memory of the previous iterations is reused
+    CHECK(arena.get_memory_size() == memory_size);
+  }
+
+  arena.allocate(1);
+  arena.reset();
+  auto end_marker = arena.get_marker();
+  CHECK(end_marker.block == 0 && end_marker.pos == 0);
+}
+
+TEST(Arena, allocator) {
+  td::Arena arena;
+  td::ArenaVector<int> v{td::ArenaAllocator<int>(arena)};
+  for (int i = 0; i < 1000; i++) {
+    v.push_back(i);
+  }
+  for (int i = 0; i < 1000; i++) {
+    CHECK(v[i] == i);
+  }
+  // old buffers of the vector aren't freed, but their total size is less than the final capacity
+  auto memory_size = arena.get_memory_size();
+  CHECK(memory_size < 3 * 1000 * sizeof(int) + (1 << 12));
+
+  std::map<int, int, std::less<int>, td::ArenaAllocator<std::pair<const int, int>>> map{
+      td::ArenaAllocator<std::pair<const int, int>>(arena)};
+  for (int i = 0; i < 1000; i++) {
+    map[td::Random::fast(0, 100)]++;
+  }
+  int total = 0;
+  for (auto &it : map) {
+    total += it.second;
+  }
+  CHECK(total == 1000);
+}
+
+TEST(Arena, thread_local_arena) {
+  auto &arena = td::Arena::get_thread_local();
+  auto marker = arena.get_marker();
+  {
+    td::ArenaScope scope;
+    CHECK(&scope.arena() == &arena);
+    auto words = td::full_split(td::Slice("a b c"), ' ', scope.arena());
+    CHECK(words.size() == 3u);
+  }
+  auto end_marker = arena.get_marker();
+  CHECK(end_marker.block == marker.block && end_marker.pos == marker.pos);
+}
+
+static td::string get_words_text() {
+  td::StringBuilder sb({}, true);
+  for (int i = 0; i < 1000; i++) {
+    sb << "word" << i % 37 << (i % 10 == 9 ? "\n" : " ");
+  }
+  return sb.as_cslice().str();
+}
+
+class FullSplitBenchmark : public td::Benchmark {
+ public:
+  td::string get_description() const override {
+    return "full_split";
+  }
+  void start_up() override {
+    text_ = get_words_text();
+  }
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      for (auto line : td::full_split(td::Slice(text_), '\n')) {
+        total_size += td::full_split(line, ' ').size();
+      }
+    }
+    CHECK(total_size != 0);
+  }
+
+ private:
+  td::string text_;
+};
+
+class ArenaFullSplitBenchmark : public td::Benchmark {
+ public:
+  td::string get_description() const override {
+    return "full_split with Arena";
+  }
+  void start_up() override {
+    text_ = get_words_text();
+  }
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      td::ArenaScope scope;
+      for (auto line : td::full_split(td::Slice(text_), '\n', scope.arena())) {
+        total_size += td::full_split(line, ' ', scope.arena()).size();
+      }
+    }
+    CHECK(total_size != 0);
+  }
+
+ private:
+  td::string text_;
+};
+
+TEST(Arena, benchmark) {
+  td::bench(FullSplitBenchmark());
+  td::bench(ArenaFullSplitBenchmark());
+}
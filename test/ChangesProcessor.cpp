@@ -0,0 +1,167 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/ChangesProcessor.h"
+#include "td/utils/common.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+TEST(ChangesProcessor, simple) {
+  td::ChangesProcessor<int> processor;
+  td::ConcurrentChangesProcessor<int> concurrent_processor(16);
+  std::vector<int> processed;
+  std::vector<int> concurrent_processed;
+  for (int it = 0; it < 1000; it++) {
+    int n = td::Random::fast(1, 16);
+    std::vector<std::pair<td::uint64, td::uint64>> tokens;
+    for (int i = 0; i < n; i++) {
+      tokens.emplace_back(processor.add(i), concurrent_processor.add(i).move_as_ok());
+    }
+    if (n == 16) {
+      ASSERT_TRUE(concurrent_processor.add(n).is_error());
+    }
+    std::random_shuffle(tokens.begin(), tokens.end());
+    for (auto &token : tokens) {
+      processor.finish(token.first, [&](int x) { processed.push_back(x); });
+      concurrent_processor.finish(token.second);
+      concurrent_processor.process_finished([&](int x) { concurrent_processed.push_back(x); });
+      ASSERT_EQ(processed, concurrent_processed);
+    }
+    ASSERT_EQ(static_cast<size_t>(n), processed.size());
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(i, processed[i]);
+    }
+    processed.clear();
+    concurrent_processed.clear();
+  }
+}
+
+#if !TD_THREAD_UNSUPPORTED
+class MutexChangesProcessor {
+ public:
+  td::uint64 add(td::uint64 data) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return processor_.add(std::move(data));
+  }
+  void finish(td::uint64 token) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    processor_.finish(token, [&](td::uint64 data) { on_processed(data); });
+  }
+  void process_finished() {
+  }
+  size_t get_processed_count() const {
+    return processed_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::mutex mutex_;
+  td::ChangesProcessor<td::uint64> processor_;
+  std::atomic<size_t> processed_count_{0};
+
+  void on_processed(td::uint64 data) {
+    CHECK(data == processed_count_.load(std::memory_order_relaxed));
+    processed_count_.store(data + 1, std::memory_order_relaxed);
+  }
+};
+
+class LockFreeChangesProcessor {
+ public:
+  td::uint64 add(td::uint64 data) {
+    while (true) {
+      auto r_token = processor_.add(data);
+      if (r_token.is_ok()) {
+        return r_token.move_as_ok();
+      }
+      process_finished();
+      td::this_thread::yield();
+    }
+  }
+  void finish(td::uint64 token) {
+    processor_.finish(token);
+  }
+  void process_finished() {
+    processor_.process_finished([&](td::uint64 data) {
+      CHECK(data == processed_count_);
+      processed_count_++;
+    });
+  }
+  size_t get_processed_count() const {
+    return processed_count_;
+  }
+
+ private:
+  td::ConcurrentChangesProcessor<td::uint64> processor_{1 << 12};
+  size_t processed_count_ = 0;
+};
+
+// changes are added and processed in the main thread and are finished in worker threads
+template <class ProcessorT>
+static void run_changes(int n, int thread_count) {
+  ProcessorT processor;
+  std::vector<std::atomic<td::uint64>> tokens(n);
+  for (auto &token : tokens) {
+    token.store(0, std::memory_order_relaxed);
+  }
+  std::atomic<int> next_finished{0};
+  std::vector<td::thread> threads;
+  for (int i = 0; i < thread_count; i++) {
+    threads.emplace_back([&] {
+      while (true) {
+        auto pos = next_finished.fetch_add(1, std::memory_order_relaxed);
+        if (pos >= n) {
+          break;
+        }
+        td::uint64 token;
+        while ((token = tokens[pos].load(std::memory_order_acquire)) == 0) {
+          td::this_thread::yield();
+        }
+        processor.finish(token);
+      }
+    });
+  }
+  for (int i = 0; i < n; i++) {
+    tokens[i].store(processor.add(i), std::memory_order_release);
+    if ((i & 15) == 0) {
+      processor.process_finished();
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  processor.process_finished();
+  CHECK(processor.get_processed_count() == static_cast<size_t>(n));
+}
+
+TEST(ChangesProcessor, multi_thread) {
+  run_changes<LockFreeChangesProcessor>(100000, 3);
+  run_changes<MutexChangesProcessor>(100000, 3);
+}
+
+template <class ProcessorT>
+class ChangesProcessorBenchmark : public td::Benchmark {
+ public:
+  ChangesProcessorBenchmark(std::string description, int thread_count)
+      : description_(std::move(description)), thread_count_(thread_count) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << description_ << " with " << thread_count_ << " finishing threads";
+  }
+  void run(int n) override {
+    run_changes<ProcessorT>(n, thread_count_);
+  }
+
+ private:
+  std::string description_;
+  int thread_count_;
+};
+
+TEST(ChangesProcessor, benchmark) {
+  for (int thread_count : {1, 4}) {
+    td::bench(ChangesProcessorBenchmark<MutexChangesProcessor>("ChangesProcessor with mutex", thread_count));
+    td::bench(ChangesProcessorBenchmark<LockFreeChangesProcessor>("ConcurrentChangesProcessor", thread_count));
+  }
+}
+#endif
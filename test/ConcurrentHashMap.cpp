@@ -4,12 +4,14 @@
 #include "td/utils/SpinLock.h"
 #include "td/utils/HazardPointers.h"
 #include "td/utils/ConcurrentHashTable.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/Random.h"
 #include <algorithm>
 
+#include <unordered_map>
+
 #if TD_HAVE_ABSL
 #include <absl/container/flat_hash_map.h>
-#else
-#include <unordered_map>
 #endif
 
 #if TD_WITH_JUNCTION
@@ -234,3 +236,105 @@ TEST(ConcurrentHashMap, Benchmark) {
 #endif
 }
 
+
+// single-threaded benchmarks of the non-concurrent hash maps
+template <class HashMap, class KeyT>
+class HashMapLookupBenchmark : public td::Benchmark {
+ public:
+  HashMapLookupBenchmark(std::string name, size_t size) : name_(std::move(name)), size_(size) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << name_ << " size = " << size_;
+  }
+  void start_up() override {
+    keys_.clear();
+    for (size_t i = 0; i < size_ * 2; i++) {
+      keys_.push_back(gen_key(td::Random::fast_uint64()));
+    }
+    hash_map_ = HashMap();
+    for (size_t i = 0; i < size_; i++) {
+      hash_map_[keys_[i]] = static_cast<int>(i);
+    }
+  }
+  void run(int n) override {
+    // half of lookups are misses
+    size_t pos = 0;
+    int found = 0;
+    for (int i = 0; i < n; i++) {
+      found += static_cast<int>(hash_map_.count(keys_[pos]));
+      pos = (pos + 7919) % keys_.size();
+    }
+    td::do_not_optimize_away(found);
+  }
+
+ private:
+  std::string name_;
+  size_t size_;
+  std::vector<KeyT> keys_;
+  HashMap hash_map_;
+
+  static td::uint64 gen_key_impl(td::uint64 x, td::uint64 *) {
+    return x;
+  }
+  static std::string gen_key_impl(td::uint64 x, std::string *) {
+    return PSTRING() << "key_" << x;
+  }
+  static KeyT gen_key(td::uint64 x) {
+    return gen_key_impl(x, static_cast<KeyT *>(nullptr));
+  }
+};
+
+template <class HashMap>
+class HashMapChurnBenchmark : public td::Benchmark {
+ public:
+  explicit HashMapChurnBenchmark(std::string name) : name_(std::move(name)) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << name_ << " insert/erase churn";
+  }
+  void run(int n) override {
+    HashMap hash_map;
+    constexpr td::uint64 WINDOW = 1 << 14;
+    for (int i = 0; i < n; i++) {
+      auto key = static_cast<td::uint64>(i) * 0x9E3779B97F4A7C15ull;
+      hash_map[key] = i;
+      if (static_cast<td::uint64>(i) >= WINDOW) {
+        hash_map.erase((static_cast<td::uint64>(i) - WINDOW) * 0x9E3779B97F4A7C15ull);
+      }
+    }
+    td::do_not_optimize_away(hash_map.size());
+  }
+
+ private:
+  std::string name_;
+};
+
+template <class KeyT, template <class, class> class HashMapT>
+static void bench_hash_map_lookup(std::string name) {
+  for (size_t size : {100, 100000, 1000000}) {
+    td::bench(HashMapLookupBenchmark<HashMapT<KeyT, int>, KeyT>(name, size));
+  }
+}
+
+template <class KeyT, class ValueT>
+using StdUnorderedMap = std::unordered_map<KeyT, ValueT>;
+template <class KeyT, class ValueT>
+using TdFlatHashMap = td::FlatHashMap<KeyT, ValueT, std::hash<KeyT>>;
+#if TD_HAVE_ABSL
+template <class KeyT, class ValueT>
+using AbslFlatHashMap = absl::flat_hash_map<KeyT, ValueT>;
+#endif
+
+TEST(HashMap, Benchmark) {
+  bench_hash_map_lookup<td::uint64, TdFlatHashMap>("td::FlatHashMap<uint64>");
+  bench_hash_map_lookup<td::uint64, StdUnorderedMap>("std::unordered_map<uint64>");
+  bench_hash_map_lookup<std::string, TdFlatHashMap>("td::FlatHashMap<string>");
+  bench_hash_map_lookup<std::string, StdUnorderedMap>("std::unordered_map<string>");
+  td::bench(HashMapChurnBenchmark<TdFlatHashMap<td::uint64, int>>("td::FlatHashMap"));
+  td::bench(HashMapChurnBenchmark<StdUnorderedMap<td::uint64, int>>("std::unordered_map"));
+#if TD_HAVE_ABSL
+  bench_hash_map_lookup<td::uint64, AbslFlatHashMap>("absl::flat_hash_map<uint64>");
+  bench_hash_map_lookup<std::string, AbslFlatHashMap>("absl::flat_hash_map<string>");
+  td::bench(HashMapChurnBenchmark<AbslFlatHashMap<td::uint64, int>>("absl::flat_hash_map"));
+#endif
+}
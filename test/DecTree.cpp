@@ -0,0 +1,150 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/DecTree.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <utility>
+
+TEST(DecTree, random) {
+  td::DecTree<int, std::string> tree;
+  std::map<int, std::string> map;
+  for (int i = 0; i < 300000; i++) {
+    int key = td::Random::fast(0, 999);
+    int x = td::Random::fast(0, 3);
+    if (x == 0) {
+      auto value = td::to_string(td::Random::fast_uint32());
+      tree.insert(key, value);
+      map.emplace(key, value);
+    } else if (x == 1) {
+      tree.remove(key);
+      map.erase(key);
+    } else if (x == 2) {
+      auto value = tree.get(key);
+      auto it = map.find(key);
+      if (it == map.end()) {
+        ASSERT_TRUE(value == nullptr);
+      } else {
+        ASSERT_TRUE(value != nullptr);
+        ASSERT_EQ(it->second, *value);
+      }
+      ASSERT_EQ(it != map.end(), tree.exists(key));
+    } else {
+      auto value = tree.get_random();
+      ASSERT_EQ(map.empty(), value == nullptr);
+    }
+    ASSERT_EQ(map.size(), tree.size());
+  }
+}
+
+TEST(DecTree, build_from_sorted) {
+  for (int n : {0, 1, 2, 3, 10, 1000, 100000}) {
+    std::vector<std::pair<int, int>> items;
+    for (int i = 0; i < n; i++) {
+      items.emplace_back(i * 2, i);
+    }
+    td::DecTree<int, int> tree;
+    tree.insert(-1, -1);
+    tree.build_from_sorted(items);
+    ASSERT_EQ(static_cast<size_t>(n), tree.size());
+    ASSERT_TRUE(!tree.exists(-1));
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(i, *tree.get(i * 2));
+      ASSERT_TRUE(tree.get(i * 2 + 1) == nullptr);
+    }
+    for (int i = 0; i < n; i += 2) {
+      tree.remove(i * 2);
+      tree.insert(i * 2 + 1, -i);
+    }
+    ASSERT_EQ(static_cast<size_t>(n), tree.size());
+    for (int i = 0; i < n; i++) {
+      if (i % 2 == 0) {
+        ASSERT_EQ(-i, *tree.get(i * 2 + 1));
+      } else {
+        ASSERT_EQ(i, *tree.get(i * 2));
+      }
+    }
+
+    auto moved_tree = std::move(tree);
+    ASSERT_EQ(0u, tree.size());
+    ASSERT_EQ(static_cast<size_t>(n), moved_tree.size());
+  }
+}
+
+class DecTreeBenchmark : public td::Benchmark {
+ public:
+  enum class Type { Insert, Build, Get, GetRandom };
+  explicit DecTreeBenchmark(Type type) : type_(type) {
+  }
+  std::string get_description() const override {
+    switch (type_) {
+      case Type::Insert:
+        return "DecTree insert";
+      case Type::Build:
+        return "DecTree build_from_sorted";
+      case Type::Get:
+        return PSTRING() << "DecTree get with " << TREE_SIZE << " keys";
+      case Type::GetRandom:
+        return PSTRING() << "DecTree get_random with " << TREE_SIZE << " keys";
+      default:
+        UNREACHABLE();
+        return "";
+    }
+  }
+  void start_up() override {
+    std::vector<std::pair<td::uint64, td::uint64>> items;
+    for (td::uint64 i = 0; i < TREE_SIZE; i++) {
+      items.emplace_back(i, i);
+    }
+    tree_.build_from_sorted(items);
+  }
+  void run(int n) override {
+    td::uint64 result = 0;
+    switch (type_) {
+      case Type::Insert: {
+        td::DecTree<td::uint64, td::uint64> tree;
+        for (int i = 0; i < n; i++) {
+          tree.insert(td::Random::fast_uint64(), i);
+        }
+        result = tree.size();
+        break;
+      }
+      case Type::Build: {
+        std::vector<std::pair<td::uint64, td::uint64>> items;
+        for (int i = 0; i < n; i++) {
+          items.emplace_back(i, i);
+        }
+        td::DecTree<td::uint64, td::uint64> tree;
+        tree.build_from_sorted(items);
+        result = tree.size();
+        break;
+      }
+      case Type::Get:
+        for (int i = 0; i < n; i++) {
+          result += *tree_.get(td::Random::fast_uint32() % TREE_SIZE);
+        }
+        break;
+      case Type::GetRandom:
+        for (int i = 0; i < n; i++) {
+          result += *tree_.get_random();
+        }
+        break;
+      default:
+        UNREACHABLE();
+    }
+    td::do_not_optimize_away(result);
+  }
+
+ private:
+  static constexpr td::uint32 TREE_SIZE = 1 << 20;
+  Type type_;
+  td::DecTree<td::uint64, td::uint64> tree_;
+};
+
+TEST(DecTree, benchmark) {
+  td::bench(DecTreeBenchmark(DecTreeBenchmark::Type::Insert));
+  td::bench(DecTreeBenchmark(DecTreeBenchmark::Type::Build));
+  td::bench(DecTreeBenchmark(DecTreeBenchmark::Type::Get));
+  td::bench(DecTreeBenchmark(DecTreeBenchmark::Type::GetRandom));
+}
@@ -0,0 +1,112 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/DistributedRwMutex.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/RwMutex.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <thread>
+
+#if !TD_THREAD_UNSUPPORTED
+template <class ThreadT>
+static void test_distributed_rw_mutex(bool prefer_writers) {
+  td::DistributedRwMutex mutex(prefer_writers);
+  int threads_n = 8;
+  int a = 0;
+  int b = 0;
+  std::vector<ThreadT> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 100000; j++) {
+        if ((j + i) % 100 == 0) {
+          auto lock = mutex.lock_write().move_as_ok();
+          a++;
+          b++;
+        } else {
+          auto lock = mutex.lock_read().move_as_ok();
+          CHECK(a == b);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(a == threads_n * 1000);
+  CHECK(a == b);
+}
+
+TEST(DistributedRwMutex, prefer_writers) {
+  test_distributed_rw_mutex<td::thread>(true);
+}
+
+TEST(DistributedRwMutex, prefer_readers) {
+  test_distributed_rw_mutex<td::thread>(false);
+}
+
+TEST(DistributedRwMutex, foreign_threads) {
+  // threads not created by td::thread share identifier 0, but must use different slots
+  test_distributed_rw_mutex<std::thread>(true);
+  test_distributed_rw_mutex<std::thread>(false);
+}
+
+TEST(DistributedRwMutex, unsafe) {
+  std::vector<td::DistributedRwMutex> mutexes(3);
+  mutexes[1].lock_read_unsafe();
+  mutexes[1].lock_read_unsafe();
+  mutexes[1].unlock_read_unsafe();
+  mutexes[1].unlock_read_unsafe();
+  mutexes[1].lock_write_unsafe();
+  mutexes[1].unlock_write_unsafe();
+}
+
+template <class MutexT>
+class RwMutexBenchmark : public td::Benchmark {
+ public:
+  RwMutexBenchmark(int threads_n, int write_period, td::string name)
+      : threads_n_(threads_n), write_period_(write_period), name_(std::move(name)) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << name_ << " threads_n = " << threads_n_ << " write_period = " << write_period_;
+  }
+  void run(int n) override {
+    MutexT mutex;
+    td::int64 value = 0;
+    std::vector<td::thread> threads;
+    for (int i = 0; i < threads_n_; i++) {
+      threads.emplace_back([&, i] {
+        td::int64 sum = 0;
+        for (int j = i; j < n; j += threads_n_) {
+          if (j % write_period_ == 0) {
+            auto lock = mutex.lock_write().move_as_ok();
+            value++;
+          } else {
+            auto lock = mutex.lock_read().move_as_ok();
+            sum += value;
+          }
+        }
+        td::do_not_optimize_away(sum);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+ private:
+  int threads_n_;
+  int write_period_;
+  td::string name_;
+};
+
+TEST(DistributedRwMutex, benchmark) {
+  for (int threads_n : {1, 4, 16}) {
+    td::bench(RwMutexBenchmark<td::DistributedRwMutex>(threads_n, 10000, "DistributedRwMutex"));
+    td::bench(RwMutexBenchmark<td::RwMutex>(threads_n, 10000, "RwMutex"));
+  }
+  td::bench(RwMutexBenchmark<td::DistributedRwMutex>(4, 10, "DistributedRwMutex"));
+  td::bench(RwMutexBenchmark<td::RwMutex>(4, 10, "RwMutex"));
+}
+#endif  //!TD_THREAD_UNSUPPORTED
@@ -0,0 +1,141 @@
+#include "td/utils/common.h"
+#include "td/utils/FlatHashMap.h"
+#include "td/utils/FlatHashSet.h"
+#include "td/utils/HashMap.h"
+#include "td/utils/HashSet.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tests.h"
+
+#include <map>
+#include <set>
+
+// all keys collide, so probing and tombstones are exercised
+struct BadHash {
+  size_t operator()(td::uint64 key) const {
+    return static_cast<size_t>(key % 3);
+  }
+};
+
+template <class HashMapT>
+static void test_hash_map_random(td::uint64 max_key) {
+  HashMapT hash_map;
+  std::map<td::uint64, int> reference;
+  for (int i = 0; i < 100000; i++) {
+    auto key = td::Random::fast_uint64() % max_key;
+    switch (td::Random::fast(0, 5)) {
+      case 0:
+      case 1: {
+        auto value = td::Random::fast(0, 1000);
+        hash_map[key] = value;
+        reference[key] = value;
+        break;
+      }
+      case 2: {
+        auto result = hash_map.emplace(key, i);
+        auto reference_result = reference.emplace(key, i);
+        CHECK(result.second == reference_result.second);
+        CHECK(result.first->second == reference_result.first->second);
+        break;
+      }
+      case 3:
+      case 4:
+        CHECK(hash_map.erase(key) == reference.erase(key));
+        break;
+      case 5: {
+        auto it = hash_map.find(key);
+        auto reference_it = reference.find(key);
+        CHECK((it == hash_map.end()) == (reference_it == reference.end()));
+        if (it != hash_map.end()) {
+          CHECK(it->second == reference_it->second);
+          hash_map.erase(it);
+          reference.erase(reference_it);
+        }
+        break;
+      }
+    }
+    CHECK(hash_map.size() == reference.size());
+  }
+
+  std::map<td::uint64, int> content(hash_map.begin(), hash_map.end());
+  CHECK(content == reference);
+
+  auto copy = hash_map;
+  CHECK(copy == hash_map);
+  auto moved = std::move(copy);
+  CHECK(moved == hash_map);
+  hash_map.clear();
+  CHECK(hash_map.empty());
+  CHECK(hash_map.begin() == hash_map.end());
+  CHECK(moved.size() == reference.size());
+}
+
+TEST(FlatHashMap, random) {
+  test_hash_map_random<td::FlatHashMap<td::uint64, int>>(10);
+  test_hash_map_random<td::FlatHashMap<td::uint64, int>>(1000);
+  test_hash_map_random<td::FlatHashMap<td::uint64, int>>(1000000);
+  test_hash_map_random<td::FlatHashMap<td::uint64, int, BadHash>>(300);
+  test_hash_map_random<td::HashMap<td::uint64, int>>(1000);
+}
+
+TEST(FlatHashMap, tombstones) {
+  // erase everything many times; tombstones must not make the table grow indefinitely
+  td::FlatHashMap<td::uint64, int> hash_map;
+  for (td::uint64 round = 0; round < 100; round++) {
+    for (td::uint64 i = 0; i < 1000; i++) {
+      hash_map[round * 1000 + i] = 1;
+    }
+    for (td::uint64 i = 0; i < 1000; i++) {
+      CHECK(hash_map.erase(round * 1000 + i) == 1);
+    }
+  }
+  CHECK(hash_map.empty());
+  CHECK(hash_map.capacity() <= 4096);
+}
+
+TEST(FlatHashMap, string_keys) {
+  td::FlatHashMap<td::string, int> hash_map;
+  for (int i = 0; i < 1000; i++) {
+    hash_map.try_emplace(PSTRING() << "key" << i, i);
+  }
+  CHECK(hash_map.size() == 1000);
+  for (int i = 0; i < 1000; i++) {
+    auto key = PSTRING() << "key" << i;
+    auto it = hash_map.find(td::Slice(key));
+    CHECK(it != hash_map.end());
+    CHECK(it->second == i);
+    CHECK(hash_map.at(key) == i);
+  }
+  CHECK(hash_map.count(td::Slice("key1000")) == 0);
+  CHECK(hash_map.erase(td::Slice("key10")) == 1);
+  CHECK(!hash_map.contains(td::Slice("key10")));
+  hash_map["key10"] = 5;
+  CHECK(hash_map[td::string("key10")] == 5);
+  hash_map.insert_or_assign("key10", 6);
+  CHECK(hash_map.at(td::Slice("key10")) == 6);
+
+  td::FlatHashMap<td::string, td::unique_ptr<int>> move_only;
+  for (int i = 0; i < 100; i++) {
+    move_only[PSTRING() << i] = td::make_unique<int>(i);
+  }
+  for (int i = 0; i < 100; i++) {
+    CHECK(*move_only[PSTRING() << i] == i);
+  }
+}
+
+TEST(FlatHashSet, simple) {
+  td::HashSet<td::string> hash_set{"a", "b", "c"};
+  std::set<td::string> reference{"a", "b", "c"};
+  for (int i = 0; i < 10000; i++) {
+    auto key = td::to_string(td::Random::fast(0, 3000));
+    if (td::Random::fast(0, 1) == 0) {
+      CHECK(hash_set.insert(key).second == reference.insert(key).second);
+    } else {
+      CHECK(hash_set.erase(td::Slice(key)) == reference.erase(key));
+    }
+  }
+  CHECK(std::set<td::string>(hash_set.begin(), hash_set.end()) == reference);
+  for (auto &key : reference) {
+    CHECK(hash_set.count(key) == 1);
+  }
+}
@@ -0,0 +1,177 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/FloodControlFast.h"
+#include "td/utils/FloodControlTable.h"
+#include "td/utils/HashMap.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+
+#include <atomic>
+
+TEST(FloodControlTable, simple) {
+  td::FloodControlTable<td::uint64> table;
+  table.add_limit(10, 3);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(table.try_add_event(1, 100));
+  }
+  ASSERT_TRUE(!table.try_add_event(1, 100));
+  ASSERT_TRUE(!table.try_add_event(1, 103));
+  ASSERT_EQ(104, table.get_wakeup_at(1));
+  ASSERT_TRUE(table.try_add_event(2, 100));
+  ASSERT_EQ(0, table.get_wakeup_at(3));
+
+  ASSERT_TRUE(table.try_add_event(1, 104));
+  ASSERT_TRUE(!table.try_add_event(1, 104));
+  table.clear_events(1);
+  ASSERT_TRUE(table.try_add_event(1, 104));
+
+  ASSERT_TRUE(table.add_event(4, 100) <= 100);
+  ASSERT_TRUE(table.add_event(4, 100) <= 100);
+  ASSERT_EQ(104, table.add_event(4, 100));
+  ASSERT_EQ(107, table.add_event(4, 100));
+  ASSERT_EQ(107, table.get_wakeup_at(4));
+}
+
+TEST(FloodControlTable, random) {
+  const int duration = 10;
+  const int count = 5;
+  const int long_duration = 100;
+  const int long_count = 20;
+  td::FloodControlTable<int> table(4);
+  table.add_limit(duration, count);
+  table.add_limit(long_duration, long_count);
+  std::vector<std::vector<int>> accepted(100);
+  for (int now = 0; now < 10000; now++) {
+    for (int i = 0; i < 20; i++) {
+      // keys with small numbers are flooding
+      auto key = i < 10 ? i : td::Random::fast(10, static_cast<int>(accepted.size()) - 1);
+      auto wakeup_at = table.get_wakeup_at(key);
+      auto is_added = table.try_add_event(key, now);
+      ASSERT_EQ(wakeup_at <= now, is_added);
+      if (is_added) {
+        accepted[key].push_back(now);
+      }
+    }
+  }
+  for (auto &times : accepted) {
+    // a burst of count events is allowed, after that events are allowed only once in duration / count
+    for (size_t i = 0; i + 2 * count - 1 < times.size(); i++) {
+      ASSERT_TRUE(times[i + 2 * count - 1] - times[i] >= duration);
+    }
+    for (size_t i = 0; i + 2 * long_count - 1 < times.size(); i++) {
+      ASSERT_TRUE(times[i + 2 * long_count - 1] - times[i] >= long_duration);
+    }
+    ASSERT_TRUE(times.size() <= static_cast<size_t>(10000 / long_duration * long_count + long_count));
+  }
+  for (int key = 0; key < 10; key++) {
+    ASSERT_TRUE(accepted[key].size() >= static_cast<size_t>(10000 / long_duration * long_count - long_count));
+  }
+}
+
+TEST(FloodControlTable, expiration) {
+  td::FloodControlTable<td::uint64> table(2);
+  table.add_limit(10, 1);
+  for (td::uint64 key = 0; key < 10000; key++) {
+    table.add_event(key, 0);
+  }
+  ASSERT_TRUE(table.size() >= 5000u);
+  table.add_event(0, 5);
+  table.add_event(1ull << 63, 5);
+  ASSERT_TRUE(table.size() >= 5000u);
+  for (td::uint64 key = 0; key < 100; key++) {
+    table.add_event(key, 100);
+  }
+  ASSERT_TRUE(table.size() <= 100u);
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(FloodControlTable, multi_thread) {
+  const int key_count = 1000;
+  const int count = 10;
+  td::FloodControlTable<int> table(16);
+  table.add_limit(100, count);
+  std::vector<std::atomic<int>> accepted(key_count);
+  for (auto &x : accepted) {
+    x = 0;
+  }
+  std::vector<td::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < 100000; j++) {
+        auto key = td::Random::fast(0, key_count - 1);
+        if (table.try_add_event(key, 0)) {
+          accepted[key]++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (auto &x : accepted) {
+    ASSERT_EQ(count, x.load());
+  }
+}
+#endif
+
+template <class T>
+class FloodControlBenchmark : public td::Benchmark {
+ public:
+  explicit FloodControlBenchmark(std::string description) : description_(std::move(description)) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << description_ << " with " << KEY_COUNT << " keys";
+  }
+  void start_up() override {
+    flood_control_ = td::make_unique<T>();
+  }
+  void run(int n) override {
+    td::int32 now = 0;
+    td::uint64 sum = 0;
+    for (int i = 0; i < n; i++) {
+      if ((i & 1023) == 0) {
+        now++;
+      }
+      sum += flood_control_->add_event(td::Random::fast_uint32() % KEY_COUNT, now);
+    }
+    td::do_not_optimize_away(sum);
+  }
+  void tear_down() override {
+    flood_control_ = nullptr;
+  }
+
+ private:
+  static constexpr td::uint32 KEY_COUNT = 1 << 20;
+  std::string description_;
+  td::unique_ptr<T> flood_control_;
+};
+
+class FloodControlFastMap {
+ public:
+  td::uint32 add_event(td::uint64 key, td::int32 now) {
+    auto it = flood_controls_.find(key);
+    if (it == flood_controls_.end()) {
+      it = flood_controls_.emplace(key, td::FloodControlFast()).first;
+      it->second.add_limit(1, 10);
+      it->second.add_limit(60, 100);
+    }
+    return it->second.add_event(now);
+  }
+
+ private:
+  td::HashMap<td::uint64, td::FloodControlFast> flood_controls_;
+};
+
+class FloodControlTableWithLimits : public td::FloodControlTable<td::uint64> {
+ public:
+  FloodControlTableWithLimits() {
+    add_limit(1, 10);
+    add_limit(60, 100);
+  }
+};
+
+TEST(FloodControlTable, benchmark) {
+  td::bench(FloodControlBenchmark<FloodControlFastMap>("FloodControlFast map"));
+  td::bench(FloodControlBenchmark<FloodControlTableWithLimits>("FloodControlTable"));
+}
@@ -1,3 +1,4 @@
+#include "td/utils/benchmark.h"
 #include "td/utils/common.h"
 #include "td/utils/HazardPointers.h"
 #include "td/utils/logging.h"
@@ -44,10 +45,55 @@ TEST(HazardPointers, stress) {
     thread.join();
   }
   LOG(ERROR) << "Undeleted pointers: " << hazard_pointers.to_delete_size_unsafe();
-  CHECK(static_cast<int>(hazard_pointers.to_delete_size_unsafe()) <= threads_n * threads_n);
+  // every thread may keep up to 2 * threads_n retired pointers until the next scan
+  CHECK(static_cast<int>(hazard_pointers.to_delete_size_unsafe()) <= 2 * threads_n * threads_n);
   for (int i = 0; i < threads_n; i++) {
     hazard_pointers.retire(i);
   }
   CHECK(hazard_pointers.to_delete_size_unsafe() == 0);
 }
+
+class HazardPointersBenchmark : public td::Benchmark {
+ public:
+  HazardPointersBenchmark(size_t threads_n, size_t active_threads_n)
+      : threads_n_(threads_n), active_threads_n_(active_threads_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << "HazardPointers retire threads_n = " << threads_n_ << " active_threads_n = " << active_threads_n_;
+  }
+  void run(int n) override {
+    td::HazardPointers<int, 2> hazard_pointers(threads_n_);
+    std::atomic<int *> shared{new int(0)};
+    std::vector<td::thread> threads(active_threads_n_);
+    for (size_t thread_id = 0; thread_id < active_threads_n_; thread_id++) {
+      threads[thread_id] = td::thread([&, thread_id] {
+        for (int i = 0; i < n; i++) {
+          auto *old_value = hazard_pointers.protect(thread_id, 0, shared);
+          auto *new_value = new int(*old_value + 1);
+          hazard_pointers.clear(thread_id, 0);
+          if (shared.compare_exchange_strong(old_value, new_value)) {
+            hazard_pointers.retire(thread_id, old_value);
+          } else {
+            delete new_value;
+          }
+        }
+        hazard_pointers.retire(thread_id);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    delete shared.load();
+  }
+
+ private:
+  size_t threads_n_;
+  size_t active_threads_n_;
+};
+
+TEST(HazardPointers, benchmark) {
+  td::bench(HazardPointersBenchmark(1, 1));
+  td::bench(HazardPointersBenchmark(64, 1));
+  td::bench(HazardPointersBenchmark(64, 4));
+}
 #endif  //!TD_THREAD_UNSUPPORTED
@@ -0,0 +1,281 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/filesystem.h"
+#include "td/utils/Hints.h"
+#include "td/utils/logging.h"
+#include "td/utils/misc.h"
+#include "td/utils/port/path.h"
+#include "td/utils/Random.h"
+#include "td/utils/Slice.h"
+#include "td/utils/tests.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+// straightforward implementation of Hints for names consisting of lowercase latin letters
+class ReferenceHints {
+ public:
+  void add(td::int64 key, td::Slice name) {
+    if (name.empty()) {
+      names_.erase(key);
+      ratings_.erase(key);
+    } else {
+      names_[key] = name.str();
+    }
+  }
+  void set_rating(td::int64 key, td::int64 rating) {
+    ratings_[key] = rating;
+  }
+  std::pair<size_t, td::vector<td::int64>> search(td::Slice query, td::int32 limit, bool return_all_for_empty_query) {
+    auto query_words = td::full_split(query, ' ');
+    td::vector<std::pair<td::int64, td::int64>> results;
+    for (auto &it : names_) {
+      auto words = td::full_split(td::Slice(it.second), ' ');
+      bool is_found = return_all_for_empty_query || !query_words.empty();
+      for (auto query_word : query_words) {
+        is_found &= std::any_of(words.begin(), words.end(),
+                                [&](td::Slice word) { return td::begins_with(word, query_word); });
+      }
+      if (is_found) {
+        auto rating_it = ratings_.find(it.first);
+        results.emplace_back(rating_it == ratings_.end() ? 0 : rating_it->second, it.first);
+      }
+    }
+    std::sort(results.begin(), results.end());
+    auto total_size = results.size();
+    if (results.size() > static_cast<size_t>(limit)) {
+      results.resize(limit);
+    }
+    return {total_size, td::transform(results, [](auto &result) { return result.second; })};
+  }
+
+ private:
+  std::map<td::int64, td::string> names_;
+  std::map<td::int64, td::int64> ratings_;
+};
+
+static td::string get_random_name(int max_word_count) {
+  td::string name;
+  auto word_count = td::Random::fast(1, max_word_count);
+  for (int i = 0; i < word_count; i++) {
+    if (i != 0) {
+      name += ' ';
+    }
+    name += td::rand_string('a', 'e', td::Random::fast(1, 4));
+  }
+  return name;
+}
+
+static void test_hints(bool use_snapshots) {
+  td::CSlice snapshot_path = "hints_snapshot";
+  td::Hints hints;
+  ReferenceHints reference;
+  for (int i = 0; i < 30000; i++) {
+    td::int64 key = td::Random::fast(-1000, 1000);
+    auto type = td::Random::fast(0, 9);
+    if (type == 0) {
+      hints.remove(key);
+      reference.add(key, td::Slice());
+    } else if (type <= 2) {
+      auto rating = td::Random::fast(-5, 5);
+      hints.set_rating(key, rating);
+      reference.set_rating(key, rating);
+    } else {
+      auto name = get_random_name(3);
+      hints.add(key, name);
+      reference.add(key, name);
+    }
+
+    if (use_snapshots && i % 3000 == 0) {
+      hints.save_snapshot(snapshot_path).ensure();
+      auto size = hints.size();
+      hints = td::Hints::open_snapshot(snapshot_path).move_as_ok();
+      ASSERT_EQ(size, hints.size());
+    }
+
+    if (i % 50 == 0) {
+      for (int j = 0; j < 3; j++) {
+        auto query = get_random_name(2);
+        auto limit = td::Random::fast(0, 100);
+        ASSERT_EQ(reference.search(query, limit, false), hints.search(query, limit));
+      }
+      auto limit = td::Random::fast(0, 3000);
+      ASSERT_EQ(reference.search("", limit, true), hints.search_empty(limit));
+    }
+  }
+  td::unlink(snapshot_path).ignore();
+}
+
+TEST(Hints, random) {
+  test_hints(false);
+}
+
+TEST(Hints, snapshot) {
+  test_hints(true);
+
+  td::CSlice snapshot_path = "hints_snapshot";
+  td::Hints hints;
+  hints.add(1, "First Name");
+  hints.add(2, "Second Name");
+  hints.set_rating(2, -1);
+  hints.set_rating(3, 5);
+  hints.save_snapshot(snapshot_path).ensure();
+
+  hints = td::Hints::open_snapshot(snapshot_path).move_as_ok();
+  ASSERT_EQ(2u, hints.size());
+  ASSERT_EQ("First Name", hints.key_to_string(1));
+  ASSERT_TRUE(!hints.has_key(3));
+  ASSERT_EQ(td::vector<td::int64>({2, 1}), hints.search("name", 10).second);
+  hints.add(3, "Third Name");
+  ASSERT_EQ(td::vector<td::int64>({2, 1, 3}), hints.search("name", 10).second);
+  hints.add(1, "Renamed");
+  hints.remove(2);
+  ASSERT_EQ(td::vector<td::int64>({3}), hints.search("name", 10).second);
+  ASSERT_EQ(td::vector<td::int64>({1}), hints.search("ren", 10).second);
+  ASSERT_EQ(2u, hints.size());
+
+  auto data = td::read_file_str(snapshot_path).move_as_ok();
+  td::write_file(snapshot_path, td::Slice(data).substr(0, data.size() / 2)).ensure();
+  ASSERT_TRUE(td::Hints::open_snapshot(snapshot_path).is_error());
+  td::write_file(snapshot_path, td::string(data.size(), '\0')).ensure();
+  ASSERT_TRUE(td::Hints::open_snapshot(snapshot_path).is_error());
+  td::unlink(snapshot_path).ignore();
+}
+
+TEST(Hints, corrupted_snapshot) {
+  td::CSlice snapshot_path = "hints_snapshot";
+  td::Hints hints;
+  for (int key = 1; key <= 20; key++) {
+    hints.add(key, "aa");
+  }
+  hints.add(21, "bb");
+  hints.save_snapshot(snapshot_path).ensure();
+  auto data = td::read_file_str(snapshot_path).move_as_ok();
+  ASSERT_TRUE(td::Hints::open_snapshot(snapshot_path).is_ok());
+
+  // words are followed by the aligned posting lists
+  auto words_pos = data.find("aabb");
+  ASSERT_TRUE(words_pos != td::string::npos);
+  auto postings_pos = (words_pos + 4 + 7) / 8 * 8;
+
+  auto unsorted_data = data;
+  unsorted_data.replace(words_pos, 4, "bbaa");
+  td::write_file(snapshot_path, unsorted_data).ensure();
+  auto r_hints = td::Hints::open_snapshot(snapshot_path);
+  ASSERT_TRUE(r_hints.is_error());
+  ASSERT_EQ("Snapshot has unsorted words", r_hints.error().message());
+
+  // the posting list still ends with a complete varint, but the varint is too long
+  auto long_varint_data = data;
+  for (size_t i = 0; i < 12; i++) {
+    long_varint_data[postings_pos + i] = '\xff';
+  }
+  td::write_file(snapshot_path, long_varint_data).ensure();
+  r_hints = td::Hints::open_snapshot(snapshot_path);
+  ASSERT_TRUE(r_hints.is_error());
+  ASSERT_EQ("Snapshot has wrong keys", r_hints.error().message());
+  td::unlink(snapshot_path).ignore();
+}
+
+TEST(Hints, add_batch) {
+  td::Hints hints;
+  td::Hints batch_hints;
+  for (int round = 0; round < 20; round++) {
+    auto batch_size = round % 4 == 3 ? td::Random::fast(5000, 20000) : td::Random::fast(0, 100);
+    td::vector<td::string> names;
+    td::vector<td::int64> keys;
+    for (int i = 0; i < batch_size; i++) {
+      keys.push_back(td::Random::fast(-3000, 3000));
+      names.push_back(td::Random::fast(0, 9) == 0 ? td::string() : get_random_name(3));
+    }
+    td::vector<std::pair<td::int64, td::Slice>> batch;
+    for (int i = 0; i < batch_size; i++) {
+      hints.add(keys[i], names[i]);
+      batch.emplace_back(keys[i], names[i]);
+    }
+    batch_hints.add_batch(batch);
+
+    for (int i = 0; i < 100; i++) {
+      td::int64 key = td::Random::fast(-3000, 3000);
+      auto rating = td::Random::fast(-5, 5);
+      hints.set_rating(key, rating);
+      batch_hints.set_rating(key, rating);
+    }
+
+    ASSERT_EQ(hints.size(), batch_hints.size());
+    for (int i = 0; i < 100; i++) {
+      auto query = get_random_name(2);
+      ASSERT_EQ(hints.search(query, 50), batch_hints.search(query, 50));
+    }
+    ASSERT_EQ(hints.search_empty(10000), batch_hints.search_empty(10000));
+    for (td::int64 key = -3000; key <= 3000; key++) {
+      ASSERT_EQ(hints.key_to_string(key), batch_hints.key_to_string(key));
+    }
+  }
+}
+
+class HintsSearchBenchmark : public td::Benchmark {
+ public:
+  explicit HintsSearchBenchmark(int key_count) : key_count_(key_count) {
+  }
+  td::string get_description() const override {
+    return PSTRING() << "Hints search with " << key_count_ << " keys";
+  }
+  void start_up() override {
+    for (int i = 0; i < key_count_; i++) {
+      hints_.add(i, get_random_name(3));
+      hints_.set_rating(i, td::Random::fast(0, 1000));
+    }
+  }
+  void run(int n) override {
+    size_t found = 0;
+    for (int i = 0; i < n; i++) {
+      found += hints_.search(get_random_name(2), 10).first;
+    }
+    td::do_not_optimize_away(found);
+  }
+
+ private:
+  int key_count_;
+  td::Hints hints_;
+};
+
+class HintsAddBenchmark : public td::Benchmark {
+ public:
+  explicit HintsAddBenchmark(bool use_batch) : use_batch_(use_batch) {
+  }
+  td::string get_description() const override {
+    return use_batch_ ? "Hints add_batch" : "Hints add";
+  }
+  void run(int n) override {
+    td::vector<td::string> names;
+    for (int i = 0; i < n; i++) {
+      names.push_back(get_random_name(3));
+    }
+    td::Hints hints;
+    if (use_batch_) {
+      td::vector<std::pair<td::int64, td::Slice>> batch;
+      for (int i = 0; i < n; i++) {
+        batch.emplace_back(i, names[i]);
+      }
+      hints.add_batch(batch);
+    } else {
+      for (int i = 0; i < n; i++) {
+        hints.add(i, names[i]);
+      }
+    }
+    CHECK(hints.size() == static_cast<size_t>(n));
+  }
+
+ private:
+  bool use_batch_;
+};
+
+TEST(Hints, benchmark) {
+  for (int key_count : {1000, 100000}) {
+    td::bench(HintsSearchBenchmark(key_count));
+  }
+  td::bench(HintsAddBenchmark(false));
+  td::bench(HintsAddBenchmark(true));
+}
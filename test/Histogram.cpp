@@ -0,0 +1,205 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/Histogram.h"
+#include "td/utils/JsonBuilder.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+#include "td/utils/TimedStat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+
+static td::uint64 exact_percentile(const std::vector<td::uint64> &sorted_values, double percent) {
+  auto rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sorted_values.size()) - 1e-9));
+  return sorted_values[td::max(rank, static_cast<size_t>(1)) - 1];
+}
+
+TEST(Histogram, percentiles) {
+  for (int test = 0; test < 20; test++) {
+    td::LogHistogram<> histogram;
+    std::vector<td::uint64> values;
+    auto n = td::Random::fast(1, 10000);
+    auto max_bits = td::Random::fast(1, 45);
+    for (int i = 0; i < n; i++) {
+      auto value = td::Random::fast_uint64() >> (64 - max_bits);
+      values.push_back(value);
+      histogram.add(value);
+    }
+    std::sort(values.begin(), values.end());
+
+    CHECK(histogram.get_count() == values.size());
+    CHECK(histogram.get_min() == values[0]);
+    CHECK(histogram.get_max() == values.back());
+    for (double percent : {0.0, 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+      auto exact = exact_percentile(values, percent);
+      auto result = histogram.get_percentile(percent);
+      auto max_value = (static_cast<td::uint64>(1) << 40) - 1;
+      if (exact <= max_value) {
+        // the relative error is less than 2^-6
+        LOG_CHECK(exact <= result && result - exact <= exact / 64) << exact << ' ' << result << ' ' << percent;
+      } else {
+        // too big values are put in the last bucket, so only the exact maximum can be returned for them
+        CHECK(result == td::max(max_value, values[0]) || result == values.back());
+      }
+    }
+  }
+}
+
+TEST(Histogram, buckets) {
+  td::LogHistogram<2, 10> histogram;
+  for (td::uint64 value = 0; value < 2000; value++) {
+    histogram.add(value);
+  }
+  td::uint64 expected_lower_bound = 0;
+  td::uint64 total = 0;
+  histogram.for_each_bucket([&](td::uint64 lower_bound, td::uint64 upper_bound, td::uint64 count) {
+    CHECK(lower_bound == expected_lower_bound);
+    CHECK(lower_bound <= upper_bound);
+    if (upper_bound < 1023) {
+      CHECK(count == upper_bound - lower_bound + 1);
+      CHECK(lower_bound < 4 || (upper_bound - lower_bound + 1) * 4 <= lower_bound);
+    }
+    expected_lower_bound = upper_bound + 1;
+    total += count;
+  });
+  CHECK(expected_lower_bound == 1024);
+  CHECK(total == 2000);
+}
+
+TEST(Histogram, merge) {
+  td::LogHistogram<> a;
+  td::LogHistogram<> b;
+  td::LogHistogram<> all;
+  for (int i = 0; i < 1000; i++) {
+    auto value = td::Random::fast_uint64() % 100000;
+    (i % 3 == 0 ? a : b).add(value);
+    all.add(value);
+  }
+  a.merge(b);
+  a.merge(td::LogHistogram<>());
+  CHECK(a.get_count() == all.get_count());
+  CHECK(a.get_sum() == all.get_sum());
+  CHECK(a.get_min() == all.get_min());
+  CHECK(a.get_max() == all.get_max());
+  for (double percent : {1.0, 50.0, 99.0}) {
+    CHECK(a.get_percentile(percent) == all.get_percentile(percent));
+  }
+
+  a.clear();
+  CHECK(a.get_count() == 0);
+  CHECK(a.get_percentile(50) == 0);
+  a.add(5, 3);
+  CHECK(a.get_count() == 3);
+  CHECK(a.get_sum() == 15);
+  CHECK(a.get_percentile(50) == 5);
+}
+
+TEST(Histogram, timed_stat) {
+  td::TimedStat<td::LogHistogram<>> stat(10, 0);
+  for (int i = 0; i < 100; i++) {
+    stat.add_event(static_cast<td::uint64>(1000), i * 0.1);
+  }
+  CHECK(stat.get_stat(10).get_count() == 100);
+  CHECK(stat.get_stat(10).get_percentile(99) == 1000);
+
+  for (int i = 0; i < 100; i++) {
+    stat.add_event(static_cast<td::uint64>(10), 15 + i * 0.1);
+  }
+  // the first events are forgotten after two durations
+  auto p99 = stat.get_stat(35).get_percentile(99);
+  CHECK(stat.get_stat(35).get_count() == 100);
+  CHECK(p99 == 10);
+}
+
+TEST(Histogram, json) {
+  td::LogHistogram<> histogram;
+  CHECK(td::json_encode<td::string>(td::ToJson(histogram)) ==
+        "{\"count\":0,\"min\":0,\"max\":0,\"mean\":0.000000,\"p50\":0,\"p90\":0,\"p99\":0,\"p999\":0}");
+  for (td::uint64 value = 1; value <= 10; value++) {
+    histogram.add(value);
+  }
+  CHECK(td::json_encode<td::string>(td::ToJson(histogram)) ==
+        "{\"count\":10,\"min\":1,\"max\":10,\"mean\":5.500000,\"p50\":5,\"p90\":9,\"p99\":10,\"p999\":10}");
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(Histogram, multi_thread) {
+  int threads_n = 8;
+  int values_n = 100000;
+  td::ThreadSafeLogHistogram<> histogram;
+  std::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < values_n; j++) {
+        histogram.add(static_cast<td::uint64>(i * values_n + j));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto result = histogram.get_histogram();
+  auto total = static_cast<td::uint64>(threads_n) * values_n;
+  CHECK(result.get_count() == total);
+  CHECK(result.get_sum() == total * (total - 1) / 2);
+  CHECK(result.get_min() == 0);
+  CHECK(result.get_max() == total - 1);
+  auto median = result.get_percentile(50);
+  CHECK(total / 2 - 1 <= median && median <= total / 2 + total / 64);
+}
+
+TEST(Histogram, foreign_threads) {
+  // threads not created by td::thread share the same buckets
+  int threads_n = 4;
+  int values_n = 100000;
+  td::ThreadSafeLogHistogram<> histogram;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < values_n; j++) {
+        histogram.add(static_cast<td::uint64>(i * values_n + j));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto result = histogram.get_histogram();
+  auto total = static_cast<td::uint64>(threads_n) * values_n;
+  CHECK(result.get_count() == total);
+  CHECK(result.get_sum() == total * (total - 1) / 2);
+  CHECK(result.get_min() == 0);
+  CHECK(result.get_max() == total - 1);
+}
+#endif
+
+template <class HistogramT>
+class HistogramAddBenchmark : public td::Benchmark {
+ public:
+  explicit HistogramAddBenchmark(td::string description) : description_(std::move(description)) {
+  }
+  td::string get_description() const override {
+    return PSTRING() << description_ << " add";
+  }
+  void run(int n) override {
+    td::uint64 value = 12345;
+    for (int i = 0; i < n; i++) {
+      value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+      histogram_.add(value >> 44);
+    }
+  }
+
+ private:
+  td::string description_;
+  HistogramT histogram_;
+};
+
+TEST(Histogram, benchmark) {
+  td::bench(HistogramAddBenchmark<td::LogHistogram<>>("LogHistogram"));
+  td::bench(HistogramAddBenchmark<td::ThreadSafeLogHistogram<>>("ThreadSafeLogHistogram"));
+}
@@ -0,0 +1,103 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/MpscPollableQueue.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/tests.h"
+
+#if !TD_EVENTFD_UNSUPPORTED && !TD_THREAD_UNSUPPORTED
+TEST(MpscPollableQueue, simple) {
+  td::MpscPollableQueue<int> queue;
+  queue.init();
+  CHECK(queue.reader_wait_nonblock() == 0);
+  for (int i = 0; i < 10; i++) {
+    queue.writer_put(i);
+  }
+  CHECK(queue.reader_wait_nonblock() == 10);
+  for (int i = 0; i < 5; i++) {
+    CHECK(queue.reader_get_unsafe() == i);
+  }
+  queue.writer_put(10);
+  CHECK(queue.reader_wait_nonblock() == 5);
+  for (int i = 5; i < 10; i++) {
+    CHECK(queue.reader_get_unsafe() == i);
+  }
+  CHECK(queue.reader_wait() == 1);
+  CHECK(queue.reader_get_unsafe() == 10);
+  CHECK(queue.reader_wait_nonblock() == 0);
+  queue.writer_put(11);
+  queue.destroy();
+}
+
+TEST(MpscPollableQueue, multithreaded) {
+  int writers_n = 10;
+  int values_n = 100000;
+  td::MpscPollableQueue<std::pair<int, int>> queue;
+  queue.init();
+  std::vector<td::thread> writers;
+  for (int writer_id = 0; writer_id < writers_n; writer_id++) {
+    writers.emplace_back([&, writer_id] {
+      for (int i = 0; i < values_n; i++) {
+        queue.writer_put(std::make_pair(writer_id, i));
+      }
+    });
+  }
+  std::vector<int> next(writers_n, 0);
+  int left = writers_n * values_n;
+  while (left > 0) {
+    int ready = queue.reader_wait();
+    for (int i = 0; i < ready; i++) {
+      auto value = queue.reader_get_unsafe();
+      CHECK(next[value.first] == value.second);
+      next[value.first]++;
+    }
+    left -= ready;
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  CHECK(queue.reader_wait_nonblock() == 0);
+  queue.destroy();
+}
+
+class MpscPollableQueueBenchmark : public td::Benchmark {
+ public:
+  explicit MpscPollableQueueBenchmark(int writers_n) : writers_n_(writers_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << "MpscPollableQueue writers_n = " << writers_n_;
+  }
+  void run(int n) override {
+    td::MpscPollableQueue<int> queue;
+    queue.init();
+    std::vector<td::thread> writers;
+    for (int i = 0; i < writers_n_; i++) {
+      writers.emplace_back([&] {
+        for (int j = 0; j < n; j++) {
+          queue.writer_put(j);
+        }
+      });
+    }
+    td::int64 left = static_cast<td::int64>(n) * writers_n_;
+    while (left > 0) {
+      int ready = queue.reader_wait();
+      for (int i = 0; i < ready; i++) {
+        td::do_not_optimize_away(queue.reader_get_unsafe());
+      }
+      left -= ready;
+    }
+    for (auto &writer : writers) {
+      writer.join();
+    }
+    queue.destroy();
+  }
+
+ private:
+  int writers_n_;
+};
+
+TEST(MpscPollableQueue, benchmark) {
+  td::bench(MpscPollableQueueBenchmark(1));
+  td::bench(MpscPollableQueueBenchmark(8));
+}
+#endif
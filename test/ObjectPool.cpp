@@ -0,0 +1,60 @@
+#include "td/utils/common.h"
+#include "td/utils/ObjectPool.h"
+#include "td/utils/tests.h"
+
+class ObjectPoolNode {
+ public:
+  ObjectPoolNode() = default;
+  explicit ObjectPoolNode(int value) : value(value) {
+  }
+  void clear() {
+    value = 0;
+  }
+  int value = 0;
+};
+
+TEST(ObjectPool, simple) {
+  td::ObjectPool<ObjectPoolNode> pool;
+  auto owner = pool.create(5);
+  CHECK(owner->value == 5);
+  auto weak = owner.get_weak();
+  CHECK(weak.is_alive());
+  CHECK(weak->value == 5);
+  owner.reset();
+  CHECK(!weak.is_alive());
+
+  auto new_owner = pool.create(7);
+  CHECK(!weak.is_alive());
+  auto new_weak = new_owner.get_weak();
+  CHECK(new_weak.is_alive());
+  CHECK(new_weak->value == 7);
+  CHECK(new_weak.generation() != weak.generation());
+}
+
+TEST(ObjectPool, reserve) {
+  td::ObjectPool<ObjectPoolNode> pool;
+  pool.reserve(1000);
+  std::vector<td::ObjectPool<ObjectPoolNode>::OwnerPtr> owners;
+  std::vector<td::ObjectPool<ObjectPoolNode>::WeakPtr> weaks;
+  for (int i = 0; i < 2000; i++) {
+    owners.push_back(pool.create(i));
+    weaks.push_back(owners.back().get_weak());
+  }
+  for (int i = 0; i < 2000; i++) {
+    CHECK(weaks[i].is_alive());
+    CHECK(weaks[i]->value == i);
+  }
+  for (int i = 0; i < 2000; i += 2) {
+    owners[i].reset();
+  }
+  for (int i = 0; i < 2000; i++) {
+    CHECK(weaks[i].is_alive() == (i % 2 == 1));
+  }
+  for (int i = 0; i < 1000; i++) {
+    owners[2 * i] = pool.create(-i);
+  }
+  for (int i = 0; i < 2000; i++) {
+    CHECK(weaks[i].is_alive() == (i % 2 == 1));
+  }
+  owners.clear();
+}
@@ -1,8 +1,13 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/misc.h"
 #include "td/utils/OrderedEventsProcessor.h"
 #include "td/utils/Random.h"
 #include "td/utils/tests.h"
 
 #include <algorithm>
+#include <array>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -28,3 +33,85 @@ TEST(OrderedEventsProcessor, random) {
   }
   ASSERT_EQ(next_pos, n + offset);
 }
+
+TEST(OrderedEventsProcessor, window_limit) {
+  td::OrderedEventsProcessor<std::string> processor(10, 100);
+  std::vector<td::uint64> processed;
+  auto on_event = [&](td::uint64 seq_no, std::string data) {
+    ASSERT_EQ(td::to_string(seq_no), data);
+    processed.push_back(seq_no);
+  };
+  processor.try_add(109, "109", on_event).ensure();
+  ASSERT_TRUE(processor.try_add(110, "110", on_event).is_error());
+  ASSERT_TRUE(processor.try_add(1000, "1000", on_event).is_error());
+  for (td::uint64 seq_no = 108; seq_no > 10; seq_no--) {
+    processor.add(seq_no, td::to_string(seq_no), on_event);
+  }
+  ASSERT_TRUE(processed.empty());
+  ASSERT_TRUE(processor.has_events());
+  ASSERT_EQ(109u, processor.max_unfinished_seq_no());
+  processor.add(10, "10", on_event);
+  ASSERT_EQ(100u, processed.size());
+  for (size_t i = 0; i < processed.size(); i++) {
+    ASSERT_EQ(10 + i, processed[i]);
+  }
+  ASSERT_TRUE(!processor.has_events());
+  ASSERT_EQ(109u, processor.max_finished_seq_no());
+  processor.try_add(209, "209", on_event).ensure();
+  ASSERT_TRUE(processor.try_add(210, "210", on_event).is_error());
+
+  std::vector<std::string> cleared;
+  processor.add(150, "150", on_event);
+  processor.clear([&](std::string data) { cleared.push_back(std::move(data)); });
+  ASSERT_EQ(std::vector<std::string>({"150", "209"}), cleared);
+  ASSERT_TRUE(!processor.has_events());
+  ASSERT_EQ(0u, processor.max_finished_seq_no());
+}
+
+// thousands of streams with windows of about 1000 events
+class OrderedEventsProcessorBenchmark : public td::Benchmark {
+ public:
+  std::string get_description() const override {
+    return PSTRING() << "OrderedEventsProcessor with " << STREAM_COUNT << " streams";
+  }
+  void start_up() override {
+    processors_.clear();
+    for (int i = 0; i < STREAM_COUNT; i++) {
+      processors_.emplace_back(0);
+    }
+    next_seq_no_.assign(STREAM_COUNT, 0);
+  }
+  void run(int n) override {
+    td::uint64 sum = 0;
+    auto on_event = [&](td::uint64 seq_no, td::uint64 data) {
+      sum += data;
+    };
+    for (int i = 0; i < n; i += WINDOW_SIZE) {
+      auto stream_id = td::Random::fast(0, STREAM_COUNT - 1);
+      auto &processor = processors_[stream_id];
+      auto &next_seq_no = next_seq_no_[stream_id];
+      for (int j = 0; j < WINDOW_SIZE; j++) {
+        order_[j] = next_seq_no + j;
+      }
+      for (int j = 1; j < WINDOW_SIZE; j++) {
+        std::swap(order_[j], order_[td::Random::fast(0, j)]);
+      }
+      for (auto seq_no : order_) {
+        processor.add(seq_no, seq_no, on_event);
+      }
+      next_seq_no += WINDOW_SIZE;
+    }
+    td::do_not_optimize_away(sum);
+  }
+
+ private:
+  static constexpr int STREAM_COUNT = 1000;
+  static constexpr int WINDOW_SIZE = 1000;
+  std::vector<td::OrderedEventsProcessor<td::uint64>> processors_;
+  std::vector<td::uint64> next_seq_no_;
+  std::array<td::uint64, WINDOW_SIZE> order_;
+};
+
+TEST(OrderedEventsProcessor, benchmark) {
+  td::bench(OrderedEventsProcessorBenchmark());
+}
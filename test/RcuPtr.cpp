@@ -0,0 +1,155 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/RwMutex.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/RcuPtr.h"
+#include "td/utils/tests.h"
+
+#include <atomic>
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(RcuPtr, stress) {
+  struct Config {
+    explicit Config(int version) : version(version), name(version % 2 == 0 ? "even" : "odd") {
+    }
+    int version;
+    std::string name;
+  };
+
+  int threads_n = 8;
+  td::RcuPtr<Config> config(threads_n, td::make_unique<Config>(0));
+  std::atomic<int> last_version{0};
+  std::vector<td::thread> threads(threads_n);
+  for (int thread_id = 0; thread_id < threads_n; thread_id++) {
+    threads[thread_id] = td::thread([&, thread_id] {
+      auto locker = config.get_locker(thread_id);
+      int seen_version = 0;
+      for (int i = 0; i < 200000; i++) {
+        {
+          auto guard = config.lock_read(locker);
+          CHECK(guard);
+          CHECK(guard->version >= seen_version);
+          CHECK(guard->name == (guard->version % 2 == 0 ? "even" : "odd"));
+          seen_version = guard->version;
+        }
+        if (thread_id == 0 && i % 100 == 0) {
+          auto version = last_version.load() + 1;
+          config.update(locker, td::make_unique<Config>(version));
+          last_version = version;
+        }
+      }
+      config.retire_sync(locker);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto locker = config.get_locker(0);
+  CHECK(config.lock_read(locker)->version == last_version.load());
+}
+
+template <class ConfigPtr>
+class ReadMostlyBenchmark : public td::Benchmark {
+ public:
+  explicit ReadMostlyBenchmark(int threads_n) : threads_n_(threads_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << ConfigPtr::get_description() << " readers_n = " << threads_n_;
+  }
+  void run(int n) override {
+    ConfigPtr config(threads_n_);
+    std::vector<td::thread> threads(threads_n_);
+    for (int thread_id = 0; thread_id < threads_n_; thread_id++) {
+      threads[thread_id] = td::thread([&, thread_id] {
+        auto reader = config.get_reader(thread_id);
+        td::int64 sum = 0;
+        for (int i = thread_id; i < n; i += threads_n_) {
+          sum += reader.read();
+          if (thread_id == 0 && i % 10000 == 0) {
+            reader.write(i);
+          }
+        }
+        td::do_not_optimize_away(sum);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+ private:
+  int threads_n_;
+};
+
+class RcuConfig {
+ public:
+  static std::string get_description() {
+    return "RcuPtr";
+  }
+  explicit RcuConfig(int threads_n) : ptr_(threads_n, td::make_unique<int>(0)) {
+  }
+  class Reader {
+   public:
+    Reader(td::RcuPtr<int> &ptr, size_t thread_id) : ptr_(ptr), locker_(ptr.get_locker(thread_id)) {
+    }
+    int read() {
+      return *ptr_.lock_read(locker_);
+    }
+    void write(int value) {
+      ptr_.update(locker_, td::make_unique<int>(value));
+    }
+
+   private:
+    td::RcuPtr<int> &ptr_;
+    td::RcuPtr<int>::Locker locker_;
+  };
+  Reader get_reader(size_t thread_id) {
+    return Reader(ptr_, thread_id);
+  }
+
+ private:
+  td::RcuPtr<int> ptr_;
+};
+
+class RwMutexConfig {
+ public:
+  static std::string get_description() {
+    return "RwMutex";
+  }
+  explicit RwMutexConfig(int threads_n) : ptr_(td::make_unique<int>(0)) {
+  }
+  class Reader {
+   public:
+    explicit Reader(RwMutexConfig &config) : config_(config) {
+    }
+    int read() {
+      auto lock = config_.mutex_.lock_read().move_as_ok();
+      return *config_.ptr_;
+    }
+    void write(int value) {
+      auto new_ptr = td::make_unique<int>(value);
+      auto lock = config_.mutex_.lock_write().move_as_ok();
+      std::swap(config_.ptr_, new_ptr);
+    }
+
+   private:
+    RwMutexConfig &config_;
+  };
+  Reader get_reader(size_t thread_id) {
+    return Reader(*this);
+  }
+
+ private:
+  td::RwMutex mutex_;
+  td::unique_ptr<int> ptr_;
+};
+
+TEST(RcuPtr, benchmark) {
+  for (int threads_n : {1, 8, 64}) {
+    td::bench(ReadMostlyBenchmark<RcuConfig>(threads_n));
+    td::bench(ReadMostlyBenchmark<RwMutexConfig>(threads_n));
+  }
+}
+#endif  //!TD_THREAD_UNSUPPORTED
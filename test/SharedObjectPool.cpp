@@ -1,8 +1,11 @@
+#include "td/utils/benchmark.h"
 #include "td/utils/common.h"
+#include "td/utils/port/thread.h"
 #include "td/utils/SharedObjectPool.h"
 #include "td/utils/tests.h"
 
 #include <memory>
+#include <thread>
 
 TEST(AtomicRefCnt, simple) {
   td::detail::AtomicRefCnt cnt{0};
@@ -97,3 +100,127 @@ TEST(SharedObjectPool, simple) {
   }
   CHECK(Node::cnt() == 0);
 }
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(SharedObjectPool, threads) {
+  td::SharedObjectPool<td::uint64> pool;
+  int threads_n = 8;
+  size_t objects_n = 1000;
+  int rounds_n = 100;
+  td::Stage stage;
+  std::vector<td::SharedObjectPool<td::uint64>::Ptr> objects(objects_n);
+  std::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&, i] {
+      for (int round = 0; round < rounds_n; round++) {
+        stage.wait((2 * round + 1) * (threads_n + 1));
+        std::vector<td::SharedObjectPool<td::uint64>::Ptr> local;
+        for (size_t j = i; j < objects_n; j += threads_n) {
+          local.push_back(objects[j]);
+        }
+        stage.wait((2 * round + 2) * (threads_n + 1));
+        for (auto &ptr : local) {
+          CHECK(*ptr == static_cast<td::uint64>(round));
+        }
+      }
+    });
+  }
+  for (int round = 0; round < rounds_n; round++) {
+    for (auto &ptr : objects) {
+      ptr = pool.alloc(static_cast<td::uint64>(round));
+    }
+    stage.wait((2 * round + 1) * (threads_n + 1));
+    stage.wait((2 * round + 2) * (threads_n + 1));
+    for (auto &ptr : objects) {
+      ptr.reset();
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // objects cached in magazines of other threads aren't reused
+  CHECK(pool.total_size() <= 2 * objects_n + static_cast<size_t>(threads_n + 1) * 64);
+  CHECK(pool.calc_free_size() == pool.total_size());
+}
+
+TEST(SharedObjectPool, foreign_threads) {
+  // threads not created by td::thread have the same thread identifier
+  td::SharedObjectPool<td::uint64> pool;
+  int threads_n = 4;
+  size_t objects_n = 10000;
+  for (int round = 0; round < 10; round++) {
+    std::vector<std::vector<td::SharedObjectPool<td::uint64>::Ptr>> objects(threads_n);
+    for (size_t j = 0; j < objects_n; j++) {
+      objects[j % threads_n].push_back(pool.alloc(static_cast<td::uint64>(j)));
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threads_n; i++) {
+      threads.emplace_back([&, i] {
+        for (auto &ptr : objects[i]) {
+          ptr.reset();
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+  CHECK(pool.total_size() <= 2 * objects_n + 64);
+  CHECK(pool.calc_free_size() == pool.total_size());
+}
+
+class SharedObjectPoolChurnBenchmark : public td::Benchmark {
+ public:
+  explicit SharedObjectPoolChurnBenchmark(int threads_n) : threads_n_(threads_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << "SharedObjectPool churn threads_n = " << threads_n_;
+  }
+  void run(int n) override {
+    td::SharedObjectPool<td::uint64> pool;
+    constexpr int BATCH_SIZE = 1024;
+    int rounds_n = (n + BATCH_SIZE - 1) / BATCH_SIZE;
+    td::Stage stage;
+    std::vector<td::SharedObjectPool<td::uint64>::Ptr> objects(BATCH_SIZE);
+    std::vector<td::thread> threads;
+    for (int i = 0; i < threads_n_; i++) {
+      threads.emplace_back([&, i] {
+        std::vector<td::SharedObjectPool<td::uint64>::Ptr> local;
+        for (int round = 0; round < rounds_n; round++) {
+          stage.wait((3 * round + 1) * (threads_n_ + 1));
+          for (int j = i; j < BATCH_SIZE; j += threads_n_) {
+            local.push_back(objects[j]);
+          }
+          stage.wait((3 * round + 2) * (threads_n_ + 1));
+          stage.wait((3 * round + 3) * (threads_n_ + 1));
+          // the last references are dropped here, so the objects are released by this thread
+          local.clear();
+        }
+      });
+    }
+    for (int round = 0; round < rounds_n; round++) {
+      for (auto &ptr : objects) {
+        ptr = pool.alloc(static_cast<td::uint64>(round));
+      }
+      stage.wait((3 * round + 1) * (threads_n_ + 1));
+      stage.wait((3 * round + 2) * (threads_n_ + 1));
+      for (auto &ptr : objects) {
+        ptr.reset();
+      }
+      stage.wait((3 * round + 3) * (threads_n_ + 1));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+ private:
+  int threads_n_;
+};
+
+TEST(SharedObjectPool, benchmark) {
+  for (int threads_n : {1, 4, 16}) {
+    td::bench(SharedObjectPoolChurnBenchmark(threads_n));
+  }
+}
+#endif  //!TD_THREAD_UNSUPPORTED
@@ -0,0 +1,179 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/McsLock.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/SpinLock.h"
+#include "td/utils/tests.h"
+
+#include <mutex>
+
+#if !TD_THREAD_UNSUPPORTED
+class SpinLockWrapper {
+ public:
+  static std::string get_description() {
+    return "SpinLock";
+  }
+  template <class F>
+  void with_lock(F &&f) {
+    auto lock = lock_.lock();
+    f();
+  }
+  void set_stats(td::LockStats *stats) {
+    lock_.set_stats(stats);
+  }
+
+ private:
+  td::SpinLock lock_;
+};
+
+class TicketSpinLockWrapper {
+ public:
+  static std::string get_description() {
+    return "TicketSpinLock";
+  }
+  template <class F>
+  void with_lock(F &&f) {
+    auto lock = lock_.lock();
+    f();
+  }
+  void set_stats(td::LockStats *stats) {
+    lock_.set_stats(stats);
+  }
+
+ private:
+  td::TicketSpinLock lock_;
+};
+
+class McsLockWrapper {
+ public:
+  static std::string get_description() {
+    return "McsLock";
+  }
+  template <class F>
+  void with_lock(F &&f) {
+    td::McsLock::Guard guard(lock_);
+    f();
+  }
+  void set_stats(td::LockStats *stats) {
+    lock_.set_stats(stats);
+  }
+
+ private:
+  td::McsLock lock_;
+};
+
+class MutexWrapper {
+ public:
+  static std::string get_description() {
+    return "std::mutex";
+  }
+  template <class F>
+  void with_lock(F &&f) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    f();
+  }
+  void set_stats(td::LockStats *stats) {
+  }
+
+ private:
+  std::mutex mutex_;
+};
+
+template <class LockT>
+static void test_lock() {
+  LockT lock;
+  td::LockStats stats;
+  lock.set_stats(&stats);
+  int threads_n = 8;
+  int iterations_n = 100000;
+  td::int64 a = 0;
+  td::int64 b = 0;
+  std::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < iterations_n; j++) {
+        lock.with_lock([&] {
+          CHECK(a == b);
+          a++;
+          b++;
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(a == static_cast<td::int64>(threads_n) * iterations_n);
+  CHECK(a == b);
+  LOG(INFO) << LockT::get_description() << ": " << td::tag("contended", stats.contended.load())
+            << td::tag("spins", stats.spins.load()) << td::tag("parks", stats.parks.load());
+}
+
+TEST(SpinLock, stress) {
+  test_lock<SpinLockWrapper>();
+  test_lock<TicketSpinLockWrapper>();
+  test_lock<McsLockWrapper>();
+}
+
+TEST(SpinLock, try_lock) {
+  td::TicketSpinLock ticket_lock;
+  {
+    auto lock = ticket_lock.lock();
+    CHECK(!ticket_lock.try_lock());
+  }
+  CHECK(ticket_lock.try_lock());
+
+  td::McsLock mcs_lock;
+  td::McsLock::Node node;
+  CHECK(mcs_lock.try_lock(node));
+  td::McsLock::Node other_node;
+  CHECK(!mcs_lock.try_lock(other_node));
+  mcs_lock.unlock(node);
+  CHECK(mcs_lock.try_lock(other_node));
+  mcs_lock.unlock(other_node);
+}
+
+template <class LockT>
+class LockBenchmark : public td::Benchmark {
+ public:
+  explicit LockBenchmark(int threads_n) : threads_n_(threads_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << LockT::get_description() << " threads_n = " << threads_n_;
+  }
+  void run(int n) override {
+    LockT lock;
+    td::int64 counter = 0;
+    std::vector<td::thread> threads;
+    for (int i = 0; i < threads_n_; i++) {
+      threads.emplace_back([&, i] {
+        for (int j = i; j < n; j += threads_n_) {
+          lock.with_lock([&] { counter++; });
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    CHECK(counter == n);
+  }
+
+ private:
+  int threads_n_;
+};
+
+template <class LockT>
+static void bench_lock() {
+  for (int threads_n : {1, 4, 16}) {
+    td::bench(LockBenchmark<LockT>(threads_n));
+  }
+}
+
+TEST(SpinLock, benchmark) {
+  bench_lock<SpinLockWrapper>();
+  bench_lock<TicketSpinLockWrapper>();
+  bench_lock<McsLockWrapper>();
+  bench_lock<MutexWrapper>();
+}
+#endif  //!TD_THREAD_UNSUPPORTED
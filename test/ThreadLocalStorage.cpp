@@ -0,0 +1,54 @@
+#include "td/utils/common.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/tests.h"
+#include "td/utils/ThreadLocalStorage.h"
+#include "td/utils/ThreadSafeCounter.h"
+
+TEST(ThreadLocalStorage, segments) {
+  td::ThreadLocalStorage<int> storage;
+  for (size_t thread_id : {0, 1, 63, 64, 65, 191, 192, 1000, 100000}) {
+    storage.get(thread_id) = static_cast<int>(thread_id) + 1;
+  }
+  for (size_t thread_id : {0, 1, 63, 64, 65, 191, 192, 1000, 100000}) {
+    CHECK(storage.get(thread_id) == static_cast<int>(thread_id) + 1);
+  }
+  CHECK(storage.get(2) == 0);
+  CHECK(storage.get(100001) == 0);
+
+  td::int64 sum = 0;
+  storage.for_each([&](int value) { sum += value; });
+  CHECK(sum == 1 + 2 + 64 + 65 + 66 + 192 + 193 + 1001 + 100001);
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(ThreadLocalStorage, many_threads) {
+  // more simultaneously alive threads than fixed per-thread arrays used to support
+  int threads_n = 300;
+  td::ThreadSafeCounter counter;
+  td::ThreadLocalStorage<int> storage;
+  td::Stage stage;
+  std::vector<td::thread> threads;
+  for (int i = 0; i < threads_n; i++) {
+    threads.emplace_back([&] {
+      stage.wait(threads_n);
+      for (int j = 0; j < 100; j++) {
+        counter.add(1);
+        storage.get()++;
+      }
+      stage.wait(2 * threads_n);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(counter.sum() == threads_n * 100);
+  int non_empty = 0;
+  storage.for_each([&](int value) {
+    if (value != 0) {
+      CHECK(value == 100);
+      non_empty++;
+    }
+  });
+  CHECK(non_empty == threads_n);
+}
+#endif  //!TD_THREAD_UNSUPPORTED
@@ -0,0 +1,173 @@
+#include "td/utils/benchmark.h"
+#include "td/utils/ChaseLevDeque.h"
+#include "td/utils/common.h"
+#include "td/utils/logging.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/Random.h"
+#include "td/utils/tests.h"
+#include "td/utils/ThreadPool.h"
+
+#include <atomic>
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(ChaseLevDeque, simple) {
+  td::ChaseLevDeque<int *> deque(1);
+  std::vector<int> values(100);
+  for (auto &value : values) {
+    deque.push(&value);
+  }
+  CHECK(deque.size_unsafe() == values.size());
+  CHECK(deque.steal() == &values[0]);
+  CHECK(deque.pop() == &values.back());
+  for (size_t i = values.size() - 1; i-- > 1;) {
+    CHECK(deque.pop() == &values[i]);
+  }
+  CHECK(deque.pop() == nullptr);
+  CHECK(deque.steal() == nullptr);
+}
+
+TEST(ChaseLevDeque, stress) {
+  int threads_n = 4;
+  int values_n = 1000000;
+  std::vector<int> values(values_n);
+  td::ChaseLevDeque<int *> deque(2);
+  std::atomic<int> taken{0};
+  std::atomic<bool> done{false};
+  std::vector<std::atomic<int>> seen(values_n);
+  for (auto &x : seen) {
+    x = 0;
+  }
+  auto take = [&](int *value) {
+    seen[value - &values[0]]++;
+    taken++;
+  };
+
+  std::vector<td::thread> thieves;
+  for (int i = 0; i < threads_n; i++) {
+    thieves.emplace_back([&] {
+      while (!done.load()) {
+        auto *value = deque.steal();
+        if (value != nullptr) {
+          take(value);
+        }
+      }
+    });
+  }
+  for (int i = 0; i < values_n; i++) {
+    deque.push(&values[i]);
+    if (td::Random::fast(0, 2) == 0) {
+      auto *value = deque.pop();
+      if (value != nullptr) {
+        take(value);
+      }
+    }
+  }
+  while (taken.load() != values_n) {
+    auto *value = deque.pop();
+    if (value != nullptr) {
+      take(value);
+    }
+  }
+  done = true;
+  for (auto &thread : thieves) {
+    thread.join();
+  }
+  for (auto &x : seen) {
+    CHECK(x.load() == 1);
+  }
+}
+
+TEST(ThreadPool, push) {
+  for (size_t threads_n : {0, 1, 4, 16}) {
+    std::atomic<int> sum{0};
+    {
+      td::ThreadPool pool(threads_n);
+      for (int i = 1; i <= 10000; i++) {
+        pool.push_function([&sum, &pool, i] {
+          auto *current = td::ThreadPool::get_current();
+          CHECK(current == &pool || current == nullptr);
+          if (i % 2 == 0) {
+            pool.push_function([&sum] { sum++; });
+          }
+          sum += i;
+        });
+      }
+      while (sum.load() != 10000 * 10001 / 2 + 5000) {
+        if (!pool.try_run_task()) {
+          td::this_thread::yield();
+        }
+      }
+    }
+    CHECK(sum.load() == 10000 * 10001 / 2 + 5000);
+  }
+}
+
+TEST(ThreadPool, parallel_for) {
+  td::ThreadPool pool(4);
+  for (size_t n : {0, 1, 7, 1000, 100000}) {
+    std::vector<std::atomic<int>> hits(n);
+    for (auto &x : hits) {
+      x = 0;
+    }
+    td::parallel_for(pool, 0, n, td::Random::fast(1, 100), [&](size_t i) { hits[i]++; });
+    for (auto &x : hits) {
+      CHECK(x.load() == 1);
+    }
+  }
+
+  // nested calls from the workers
+  std::atomic<size_t> total{0};
+  td::parallel_for(pool, 0, 16, 1, [&](size_t i) {
+    td::parallel_for(pool, 0, 1000, 10, [&](size_t j) { total += j; });
+  });
+  CHECK(total.load() == 16 * 999 * 1000 / 2);
+}
+
+TEST(ThreadPool, parallel_reduce) {
+  td::ThreadPool pool(4);
+  td::uint64 n = 1000000;
+  auto sum = td::parallel_reduce(
+      pool, 0, static_cast<size_t>(n), 1000, td::uint64{0}, td::uint64{0},
+      [](td::uint64 acc, size_t i) { return acc + i; }, [](td::uint64 a, td::uint64 b) { return a + b; });
+  CHECK(sum == n * (n - 1) / 2);
+
+  auto str = td::parallel_reduce(
+      pool, 0, 26, 3, std::string(), std::string(),
+      [](std::string acc, size_t i) {
+        acc += static_cast<char>('a' + i);
+        return acc;
+      },
+      [](std::string a, std::string b) { return a + b; });
+  CHECK(str == "abcdefghijklmnopqrstuvwxyz");
+}
+
+class ThreadPoolBenchmark : public td::Benchmark {
+ public:
+  explicit ThreadPoolBenchmark(size_t threads_n) : threads_n_(threads_n) {
+  }
+  std::string get_description() const override {
+    return PSTRING() << "ThreadPool parallel_reduce threads_n = " << threads_n_;
+  }
+  void start_up() override {
+    pool_ = td::make_unique<td::ThreadPool>(threads_n_);
+  }
+  void tear_down() override {
+    pool_.reset();
+  }
+  void run(int n) override {
+    auto sum = td::parallel_reduce(
+        *pool_, 0, static_cast<size_t>(n), 1024, td::uint64{0}, td::uint64{0},
+        [](td::uint64 acc, size_t i) { return acc + i * i % 7; }, [](td::uint64 a, td::uint64 b) { return a + b; });
+    td::do_not_optimize_away(sum);
+  }
+
+ private:
+  size_t threads_n_;
+  td::unique_ptr<td::ThreadPool> pool_;
+};
+
+TEST(ThreadPool, benchmark) {
+  td::bench(ThreadPoolBenchmark(0));
+  td::bench(ThreadPoolBenchmark(4));
+}
+#endif  //!TD_THREAD_UNSUPPORTED
@@ -1,10 +1,13 @@
 #include "td/utils/tests.h"
 
+#include "td/utils/benchmark.h"
 #include "td/utils/common.h"
 #include "td/utils/Heap.h"
 #include "td/utils/Random.h"
+#include "td/utils/TimingWheel.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <set>
@@ -169,3 +172,385 @@ TEST(Heap, random_events) {
     // heap.check();
   }
 }
+
+template <int K>
+static void test_heap_build() {
+  for (int n : {0, 1, 2, K, K + 1, K + 2, 100, 1000}) {
+    for (int old_n : {0, 1, 10, 1000}) {
+      std::vector<HeapNode> nodes(old_n + n);
+      std::vector<double> keys;
+      KHeap<double, K> kheap;
+      for (int i = 0; i < old_n; i++) {
+        keys.push_back(Random::fast(0, 100) * 0.5);
+        kheap.insert(keys.back(), &nodes[i]);
+      }
+      std::vector<std::pair<double, HeapNode *>> items;
+      for (int i = 0; i < n; i++) {
+        keys.push_back(Random::fast(0, 100) * 0.5);
+        items.emplace_back(keys.back(), &nodes[old_n + i]);
+      }
+      kheap.build(items);
+      kheap.check();
+      ASSERT_EQ(keys.size(), kheap.size());
+
+      std::sort(keys.begin(), keys.end());
+      for (auto key : keys) {
+        ASSERT_EQ(key, kheap.top_key());
+        auto node = kheap.pop();
+        ASSERT_TRUE(!node->in_heap());
+      }
+      ASSERT_TRUE(kheap.empty());
+    }
+  }
+}
+
+TEST(Heap, build) {
+  test_heap_build<2>();
+  test_heap_build<4>();
+  test_heap_build<8>();
+}
+
+template <int K>
+static void test_heap_random_double_keys() {
+  const int max_size = 1000;
+  std::vector<HeapNode> nodes(max_size);
+  std::multiset<double> keys;
+  std::vector<double> node_keys(max_size);
+  KHeap<double, K> kheap;
+  for (int i = 0; i < 100000; i++) {
+    int id = Random::fast(0, max_size - 1);
+    double key = Random::fast(0, 1000) * 0.25;
+    int x = Random::fast(0, 3);
+    if (x == 0) {
+      if (nodes[id].in_heap()) {
+        keys.erase(keys.find(node_keys[id]));
+        kheap.fix(key, &nodes[id]);
+      } else {
+        kheap.insert(key, &nodes[id]);
+      }
+      node_keys[id] = key;
+      keys.insert(key);
+    } else if (x == 1) {
+      if (nodes[id].in_heap()) {
+        keys.erase(keys.find(node_keys[id]));
+        kheap.erase(&nodes[id]);
+      }
+    } else if (x == 2 && !kheap.empty()) {
+      ASSERT_EQ(*keys.begin(), kheap.top_key());
+      auto node = kheap.pop();
+      ASSERT_EQ(*keys.begin(), node_keys[node - &nodes[0]]);
+      keys.erase(keys.begin());
+    }
+    ASSERT_EQ(keys.size(), kheap.size());
+    if (i % 1000 == 0) {
+      kheap.check();
+    }
+  }
+}
+
+TEST(Heap, random_double_keys) {
+  test_heap_random_double_keys<2>();
+  test_heap_random_double_keys<4>();
+  test_heap_random_double_keys<8>();
+}
+
+template <int K>
+static void test_heap_nan_keys() {
+  // the order is unspecified, but all nodes must be popped
+  std::vector<double> keys{0, 1, 2, std::nan(""), std::nan(""), 5};
+  for (size_t node_count : {keys.size(), keys.size() * 10}) {
+    std::vector<HeapNode> nodes(node_count);
+    KHeap<double, K> kheap;
+    for (size_t i = 0; i < nodes.size(); i++) {
+      kheap.insert(keys[i % keys.size()], &nodes[i]);
+    }
+    size_t popped = 0;
+    while (!kheap.empty()) {
+      auto node = kheap.pop();
+      CHECK(!node->in_heap());
+      popped++;
+    }
+    CHECK(popped == nodes.size());
+  }
+}
+
+TEST(Heap, nan_keys) {
+  test_heap_nan_keys<2>();
+  test_heap_nan_keys<4>();
+  test_heap_nan_keys<8>();
+}
+
+template <int K>
+class HeapBenchmark : public Benchmark {
+ public:
+  explicit HeapBenchmark(bool use_build) : use_build_(use_build) {
+  }
+  string get_description() const override {
+    return PSTRING() << "KHeap<double, " << K << "> with " << NODE_COUNT << " nodes"
+                     << (use_build_ ? " built at once" : "");
+  }
+  void start_up() override {
+    nodes_ = std::vector<HeapNode>(NODE_COUNT);
+    kheap_ = make_unique<KHeap<double, K>>();
+    if (use_build_) {
+      std::vector<std::pair<double, HeapNode *>> items;
+      for (auto &node : nodes_) {
+        items.emplace_back(get_key(), &node);
+      }
+      kheap_->build(items);
+    } else {
+      for (auto &node : nodes_) {
+        kheap_->insert(get_key(), &node);
+      }
+    }
+  }
+  void run(int n) override {
+    for (int i = 0; i < n; i++) {
+      if (i & 1) {
+        kheap_->fix(get_key(), &nodes_[Random::fast_uint32() & (NODE_COUNT - 1)]);
+      } else {
+        auto node = kheap_->pop();
+        kheap_->insert(get_key(), node);
+      }
+    }
+  }
+  void tear_down() override {
+    kheap_ = nullptr;
+    nodes_.clear();
+  }
+
+ private:
+  static constexpr uint32 NODE_COUNT = 1 << 20;
+
+  bool use_build_;
+  std::vector<HeapNode> nodes_;
+  unique_ptr<KHeap<double, K>> kheap_;
+
+  static double get_key() {
+    return Random::fast_uint32() * 1e-3;
+  }
+};
+
+TEST(Heap, benchmark) {
+  bench(HeapBenchmark<2>(false));
+  bench(HeapBenchmark<4>(false));
+  bench(HeapBenchmark<8>(false));
+  bench(HeapBenchmark<4>(true));
+}
+
+TEST(TimingWheel, random_events) {
+  struct Node : public TimerNode {
+    int64 tick = 0;
+  };
+  const int max_size = 1000;
+  std::vector<Node> nodes(max_size);
+  std::set<std::pair<int64, int>> expected;
+  TimingWheel wheel(1.0);
+  int64 now = 0;  // all ticks till now are already processed
+
+  auto get_timeout = [&] {
+    int x = Random::fast(0, 9);
+    int64 delta;
+    if (x < 5) {
+      delta = Random::fast(-10, 300);
+    } else if (x < 8) {
+      delta = Random::fast(0, 1 << 20);
+    } else if (x < 9) {
+      delta = Random::fast(0, 1 << 30) * static_cast<int64>(1 << 12);
+    } else {
+      delta = Random::fast(0, 1 << 30) * static_cast<int64>(1 << 20);
+    }
+    return static_cast<double>(now + delta) + (Random::fast(0, 1) ? 0.0 : 0.5);
+  };
+  auto set_tick = [&](int id, double timeout) {
+    expected.erase(std::make_pair(nodes[id].tick, id));
+    nodes[id].tick = td::max(static_cast<int64>(std::ceil(timeout)), now + 1);
+    expected.emplace(nodes[id].tick, id);
+  };
+
+  for (int i = 0; i < 300000; i++) {
+    ASSERT_EQ(expected.size(), wheel.size());
+    if (!wheel.empty()) {
+      auto wakeup_time = wheel.get_wakeup_time();
+      ASSERT_TRUE(wakeup_time > static_cast<double>(now));
+      ASSERT_TRUE(wakeup_time <= static_cast<double>(expected.begin()->first));
+    }
+
+    int id = Random::fast(0, max_size - 1);
+    int x = Random::fast(0, 9);
+    if (x < 4) {
+      auto timeout = get_timeout();
+      if (nodes[id].in_wheel()) {
+        wheel.fix(timeout, &nodes[id]);
+      } else {
+        wheel.insert(timeout, &nodes[id]);
+      }
+      set_tick(id, timeout);
+    } else if (x < 6) {
+      if (nodes[id].in_wheel()) {
+        wheel.erase(&nodes[id]);
+        expected.erase(std::make_pair(nodes[id].tick, id));
+      }
+    } else {
+      int64 new_now;
+      if (x < 8 || wheel.empty()) {
+        new_now = now + Random::fast(0, 300);
+      } else if (x < 9) {
+        new_now = now + Random::fast(0, 1 << 20);
+      } else {
+        new_now = static_cast<int64>(wheel.get_wakeup_time()) + Random::fast(0, 1);
+      }
+      wheel.advance(static_cast<double>(new_now) + 0.5, [&](TimerNode *timer_node) {
+        auto node = static_cast<Node *>(timer_node);
+        ASSERT_TRUE(!node->in_wheel());
+        ASSERT_TRUE(node->tick > now);
+        ASSERT_TRUE(node->tick <= new_now);
+        auto node_id = static_cast<int>(node - &nodes[0]);
+        ASSERT_TRUE(expected.erase(std::make_pair(node->tick, node_id)) == 1);
+      });
+      now = new_now;
+      ASSERT_TRUE(expected.empty() || expected.begin()->first > now);
+    }
+  }
+
+  for (auto &node : nodes) {
+    if (node.in_wheel()) {
+      wheel.erase(&node);
+    }
+  }
+  ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimingWheel, wakeup_time) {
+  // tick * tick_duration can be rounded down below the tick, but advance(get_wakeup_time()) must still make progress
+  struct Node : public TimerNode {
+    double timeout = 0;
+  };
+  std::vector<Node> nodes(3000);
+  TimingWheel wheel(0.001);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    nodes[i].timeout = static_cast<double>(i + 1) * 0.001;
+    wheel.insert(nodes[i].timeout, &nodes[i]);
+  }
+  size_t expired_count = 0;
+  while (!wheel.empty()) {
+    auto wakeup_time = wheel.get_wakeup_time();
+    auto old_size = wheel.size();
+    wheel.advance(wakeup_time, [&](TimerNode *timer_node) {
+      ASSERT_TRUE(static_cast<Node *>(timer_node)->timeout <= wakeup_time);
+      expired_count++;
+    });
+    ASSERT_TRUE(wheel.size() < old_size || wheel.empty() || wheel.get_wakeup_time() > wakeup_time);
+  }
+  ASSERT_EQ(nodes.size(), expired_count);
+}
+
+class HeapTimeouts {
+ public:
+  struct Node : public HeapNode {};
+
+  void insert(double timeout, Node *node) {
+    heap_.insert(timeout, node);
+  }
+  void fix(double timeout, Node *node) {
+    heap_.fix(timeout, node);
+  }
+  void erase(Node *node) {
+    heap_.erase(node);
+  }
+  template <class F>
+  void advance(double now, F &&f) {
+    while (!heap_.empty() && heap_.top_key() <= now) {
+      f(static_cast<Node *>(heap_.pop()));
+    }
+  }
+
+ private:
+  KHeap<double> heap_;
+};
+
+class TimingWheelTimeouts {
+ public:
+  struct Node : public TimerNode {};
+
+  void insert(double timeout, Node *node) {
+    wheel_.insert(timeout, node);
+  }
+  void fix(double timeout, Node *node) {
+    wheel_.fix(timeout, node);
+  }
+  void erase(Node *node) {
+    wheel_.erase(node);
+  }
+  template <class F>
+  void advance(double now, F &&f) {
+    wheel_.advance(now, [&f](TimerNode *node) { f(static_cast<Node *>(node)); });
+  }
+
+ private:
+  TimingWheel wheel_{0.001};
+};
+
+// every connection reschedules its idle timeout on activity, which is much more frequent than expiration
+template <class TimeoutsT>
+class TimeoutsBenchmark : public Benchmark {
+ public:
+  explicit TimeoutsBenchmark(string description) : description_(std::move(description)) {
+  }
+  string get_description() const override {
+    return PSTRING() << description_ << " with " << TIMER_COUNT << " timers";
+  }
+  void start_up() override {
+    now_ = 0;
+    nodes_ = std::vector<typename TimeoutsT::Node>(TIMER_COUNT);
+    timeouts_ = make_unique<TimeoutsT>();
+    for (auto &node : nodes_) {
+      timeouts_->insert(get_timeout(), &node);
+    }
+  }
+  void run(int n) override {
+    size_t expired_count = 0;
+    for (int i = 0; i < n; i++) {
+      auto node = &nodes_[Random::fast_uint32() & (TIMER_COUNT - 1)];
+      if ((i & 15) == 0) {
+        timeouts_->erase(node);
+        timeouts_->insert(get_timeout(), node);
+      } else {
+        timeouts_->fix(now_ + IDLE_TIMEOUT, node);
+      }
+      if ((i & 1023) == 0) {
+        now_ += 0.01;
+        timeouts_->advance(now_, [&](typename TimeoutsT::Node *node) {
+          expired_count++;
+          timeouts_->insert(get_timeout(), node);
+        });
+      }
+    }
+    do_not_optimize_away(expired_count);
+  }
+  void tear_down() override {
+    for (auto &node : nodes_) {
+      timeouts_->erase(&node);
+    }
+    timeouts_ = nullptr;
+    nodes_.clear();
+  }
+
+ private:
+  static constexpr uint32 TIMER_COUNT = 1 << 20;
+  static constexpr double IDLE_TIMEOUT = 30.0;
+
+  string description_;
+  double now_ = 0;
+  std::vector<typename TimeoutsT::Node> nodes_;
+  unique_ptr<TimeoutsT> timeouts_;
+
+  double get_timeout() const {
+    return now_ + 5 + Random::fast(0, 25000) * 0.001;
+  }
+};
+
+TEST(TimingWheel, benchmark) {
+  bench(TimeoutsBenchmark<HeapTimeouts>("KHeap"));
+  bench(TimeoutsBenchmark<TimingWheelTimeouts>("TimingWheel"));
+}
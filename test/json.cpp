@@ -1,5 +1,7 @@
 #include "td/utils/tests.h"
 
+#include "td/utils/Arena.h"
+#include "td/utils/benchmark.h"
 #include "td/utils/JsonBuilder.h"
 #include "td/utils/logging.h"
 #include "td/utils/Slice.h"
@@ -87,3 +89,53 @@ TEST(JSON, kphp) {
       "{\"keyboard\":[[\"\\u2022 abcdefg\"],[\"\\u2022 hijklmnop\"],[\"\\u2022 "
       "qrstuvwxyz\"]],\"one_time_keyboard\":true}");
 }
+
+TEST(JSON, big_array) {
+  // temporary memory of the decoder must not be kept after decoding of a big document
+  string str = "[1";
+  for (int i = 0; i < (1 << 20); i++) {
+    str += ",1";
+  }
+  str += ']';
+  auto value = json_decode(str).move_as_ok();
+  ASSERT_EQ(static_cast<size_t>((1 << 20) + 1), value.get_array().size());
+  ASSERT_TRUE(Arena::get_thread_local().get_memory_size() <= static_cast<size_t>(4 << 20));
+}
+
+// a typical API response: an array of small objects with nested arrays
+class JsonDecodeBenchmark : public Benchmark {
+ public:
+  string get_description() const override {
+    return "JsonDecode";
+  }
+  void start_up() override {
+    StringBuilder sb({}, true);
+    sb << '[';
+    for (int i = 0; i < 100; i++) {
+      if (i != 0) {
+        sb << ',';
+      }
+      sb << "{\"id\":" << i << ",\"name\":\"user" << i << "\",\"is_bot\":false,\"photos\":[" << i << ',' << i + 1
+         << ',' << i + 2 << "],\"status\":{\"type\":\"online\",\"expires\":" << 1000000 + i << "}}";
+    }
+    sb << ']';
+    json_ = sb.as_cslice().str();
+  }
+  void run(int n) override {
+    size_t total_size = 0;
+    for (int i = 0; i < n; i++) {
+      buffer_ = json_;
+      auto value = json_decode(buffer_).move_as_ok();
+      total_size += value.get_array().size();
+    }
+    CHECK(total_size == static_cast<size_t>(n) * 100);
+  }
+
+ private:
+  string json_;
+  string buffer_;
+};
+
+TEST(JSON, bench_decode) {
+  bench(JsonDecodeBenchmark());
+}
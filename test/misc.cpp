@@ -1,8 +1,11 @@
+#include "td/utils/Arena.h"
 #include "td/utils/as.h"
 #include "td/utils/base64.h"
 #include "td/utils/bits.h"
+#include "td/utils/benchmark.h"
 #include "td/utils/BigNum.h"
 #include "td/utils/bits.h"
+#include "td/utils/buffer.h"
 #include "td/utils/CancellationToken.h"
 #include "td/utils/common.h"
 #include "td/utils/Hash.h"
@@ -19,9 +22,11 @@
 #include "td/utils/port/sleep.h"
 #include "td/utils/port/Stat.h"
 #include "td/utils/port/thread.h"
+#include "td/utils/port/UdpSocketFd.h"
 #include "td/utils/port/wstring_convert.h"
 #include "td/utils/Random.h"
 #include "td/utils/Slice.h"
+#include "td/utils/StackAllocator.h"
 #include "td/utils/StringBuilder.h"
 #include "td/utils/tests.h"
 #include "td/utils/translit.h"
@@ -29,11 +34,16 @@
 #include "td/utils/uint128.h"
 #include "td/utils/unicode.h"
 #include "td/utils/utf8.h"
+#include "td/utils/VectorQueue.h"
 
+#include <algorithm>
 #include <atomic>
 #include <clocale>
+#include <cstdint>
+#include <deque>
 #include <limits>
 #include <locale>
+#include <tuple>
 #include <utility>
 #include <unordered_map>
 
@@ -550,6 +560,10 @@ TEST(Misc, split) {
 
 static void test_full_split(Slice str, vector<Slice> expected) {
   ASSERT_EQ(expected, td::full_split(str));
+
+  td::Arena arena;
+  auto arena_result = td::full_split(str, ' ', arena);
+  ASSERT_EQ(expected, vector<Slice>(arena_result.begin(), arena_result.end()));
 }
 
 TEST(Misc, full_split) {
@@ -595,6 +609,43 @@ TEST(Misc, StringBuilder) {
   }
 }
 
+static void check_stack_allocations(int depth) {
+  if (depth == 0) {
+    return;
+  }
+  auto size = td::Random::fast(0, 1) == 0 ? td::Random::fast(0, 100) : td::Random::fast(0, 3 << 20);
+  auto ptr = td::StackAllocator::alloc(size);
+  auto data = ptr.as_slice();
+  CHECK(data.size() == static_cast<size_t>(size));
+  CHECK(reinterpret_cast<std::uintptr_t>(data.data()) % 8 == 0);
+  auto c = static_cast<char>('a' + depth);
+  std::fill(data.begin(), data.end(), c);
+  check_stack_allocations(depth - 1);
+  CHECK(std::count(data.begin(), data.end(), c) == size);
+}
+
+TEST(Misc, StackAllocator) {
+  auto initial_memory_size = td::StackAllocator::get_memory_size();
+  for (int i = 0; i < 100; i++) {
+    check_stack_allocations(td::Random::fast(1, 20));
+  }
+  {
+    auto big = td::StackAllocator::alloc(100 << 20);
+    big.as_slice().back() = 'a';
+    CHECK(td::StackAllocator::get_memory_size() > (100 << 20));
+  }
+
+  // unused segments are released after the allocator has been idle for a while
+  for (int i = 0; i < (1 << 16); i++) {
+    auto ptr = td::StackAllocator::alloc(1000);
+    ptr.as_slice()[0] = 'a';
+  }
+  // segments, which were used before the test, can be released too
+  auto memory_size = td::StackAllocator::get_memory_size();
+  CHECK(memory_size <= initial_memory_size);
+  CHECK(memory_size < (100 << 20));
+}
+
 TEST(Misc, As) {
   char buf[100];
   as<int>(buf) = 123;
@@ -899,6 +950,211 @@ TEST(Misc, Hasher) {
   test_hash<AbslHash>();
 #endif
 }
+
+template <class ValueT>
+static void check_hash_distribution(Slice name, const std::vector<ValueT> &values) {
+  std::vector<size_t> hashes;
+  for (auto &value : values) {
+    hashes.push_back(TdHash<ValueT>()(value));
+  }
+  auto sorted_hashes = hashes;
+  std::sort(sorted_hashes.begin(), sorted_hashes.end());
+  CHECK(std::adjacent_find(sorted_hashes.begin(), sorted_hashes.end()) == sorted_hashes.end());
+
+  // both the lowest and the highest bits must be well distributed
+  size_t bucket_count = 1;
+  int bucket_bits = 0;
+  while (bucket_count < values.size()) {
+    bucket_count *= 2;
+    bucket_bits++;
+  }
+  std::vector<int> low_buckets(bucket_count);
+  std::vector<int> high_buckets(bucket_count);
+  int max_load = 0;
+  for (auto hash : hashes) {
+    auto low = ++low_buckets[hash & (bucket_count - 1)];
+    auto high = ++high_buckets[bucket_bits == 0 ? 0 : static_cast<uint64>(hash) >> (64 - bucket_bits)];
+    max_load = td::max(max_load, td::max(low, high));
+  }
+  LOG(INFO) << name << ": " << tag("size", values.size()) << tag("max_load", max_load);
+  CHECK(max_load <= 16);
+}
+
+TEST(Misc, HasherDistribution) {
+  std::vector<uint64> sequential;
+  std::vector<uint64> strided;
+  std::vector<std::pair<int32, int32>> grid;
+  std::vector<std::tuple<int32, int64, string>> tuples;
+  std::vector<string> user_names;
+  std::vector<string> urls;
+  for (int i = 0; i < 100000; i++) {
+    sequential.push_back(i);
+    strided.push_back(static_cast<uint64>(i) << 20);
+    user_names.push_back(PSTRING() << "user_" << i);
+    urls.push_back(PSTRING() << "https://example.com/chat/" << i / 100 << "/message/" << i % 100 << "?thread=1");
+  }
+  for (int32 i = 0; i < 300; i++) {
+    for (int32 j = 0; j < 300; j++) {
+      grid.emplace_back(i, j);
+      if (j < 10) {
+        tuples.emplace_back(i, j, PSTRING() << i + j);
+      }
+    }
+  }
+  check_hash_distribution("sequential", sequential);
+  check_hash_distribution("strided", strided);
+  check_hash_distribution("pairs", grid);
+  check_hash_distribution("tuples", tuples);
+  check_hash_distribution("user names", user_names);
+  check_hash_distribution("urls", urls);
+
+  // every string length must be handled
+  std::vector<string> prefixes;
+  string long_string(300, 'a');
+  for (size_t i = 0; i <= long_string.size(); i++) {
+    prefixes.push_back(long_string.substr(0, i));
+  }
+  check_hash_distribution("prefixes", prefixes);
+
+  TdHash<std::pair<int, int>> pair_hash;
+  CHECK(pair_hash(std::make_pair(1, 2)) != pair_hash(std::make_pair(1, 3)));
+  CHECK(pair_hash(std::make_pair(1, 2)) != pair_hash(std::make_pair(2, 1)));
+  CHECK(pair_hash(std::make_pair(5, 5)) != pair_hash(std::make_pair(6, 6)));
+  CHECK(TdHash<string>()(string("abc")) == TdHash<Slice>()(Slice("abc")));
+  auto combined_hash = Hasher::combine(Hasher(), 1, 2).finalize();
+  CHECK(combined_hash == pair_hash(std::make_pair(1, 2)));
+}
+
+template <class ValueT>
+class HasherBenchmark : public Benchmark {
+ public:
+  HasherBenchmark(string description, std::vector<ValueT> values)
+      : description_(std::move(description)), values_(std::move(values)) {
+  }
+  string get_description() const override {
+    return PSTRING() << "TdHash " << description_;
+  }
+  void run(int n) override {
+    size_t result = 0;
+    for (int i = 0; i < n; i++) {
+      result += TdHash<ValueT>()(values_[i & (values_.size() - 1)]);
+    }
+    do_not_optimize_away(result);
+  }
+
+ private:
+  string description_;
+  std::vector<ValueT> values_;
+};
+
+TEST(Misc, HasherBenchmark) {
+  for (size_t length : {4, 8, 16, 32, 64, 256, 1024}) {
+    std::vector<string> strings;
+    for (int i = 0; i < 1024; i++) {
+      strings.push_back(rand_string('a', 'z', static_cast<int>(length)));
+    }
+    bench(HasherBenchmark<string>(PSTRING() << "string of length " << length, std::move(strings)));
+  }
+  std::vector<uint64> integers;
+  std::vector<std::pair<int64, int32>> pairs;
+  for (int i = 0; i < 1024; i++) {
+    integers.push_back(Random::fast_uint64());
+    pairs.emplace_back(Random::fast_uint64(), Random::fast_uint32());
+  }
+  bench(HasherBenchmark<uint64>("uint64", std::move(integers)));
+  bench(HasherBenchmark<std::pair<int64, int32>>("pair<int64, int32>", std::move(pairs)));
+}
+TEST(Misc, VectorQueue) {
+  VectorQueue<string> queue;
+  std::deque<string> expected;
+  ASSERT_TRUE(queue.as_span().empty());
+  for (int i = 0; i < 100000; i++) {
+    int x = Random::fast(0, 9);
+    if (x < 5) {
+      auto str = rand_string('a', 'z', Random::fast(0, 20));
+      expected.push_back(str);
+      if (x == 0) {
+        queue.emplace(str.data(), str.size());
+      } else {
+        queue.push(std::move(str));
+      }
+    } else if (x < 7) {
+      if (!expected.empty()) {
+        ASSERT_EQ(expected.front(), queue.pop());
+        expected.pop_front();
+      }
+    } else if (x < 8) {
+      auto span = queue.as_mutable_span();
+      ASSERT_EQ(expected.empty(), span.empty());
+      size_t n = Random::fast(0, static_cast<int>(span.size()));
+      for (size_t j = 0; j < span.size(); j++) {
+        ASSERT_EQ(expected[j], span[j]);
+      }
+      queue.pop_n(n);
+      expected.erase(expected.begin(), expected.begin() + n);
+    } else if (x < 9) {
+      if (!expected.empty()) {
+        ASSERT_EQ(expected.front(), queue.front());
+        ASSERT_EQ(expected.back(), queue.back());
+      }
+    } else if (Random::fast(0, 100) == 0) {
+      queue.clear();
+      expected.clear();
+    }
+    ASSERT_EQ(expected.size(), queue.size());
+  }
+
+  auto moved_queue = std::move(queue);
+  ASSERT_TRUE(queue.empty());
+  ASSERT_EQ(expected.size(), moved_queue.size());
+}
+
+// emulates sending of a burst of messages through BufferedUdp
+class UdpQueueBenchmark : public Benchmark {
+ public:
+  explicit UdpQueueBenchmark(size_t burst_size) : burst_size_(burst_size) {
+  }
+  string get_description() const override {
+    return PSTRING() << "VectorQueue<UdpMessage> with bursts of " << burst_size_ << " messages";
+  }
+  void start_up() override {
+    for (size_t i = 0; i < burst_size_; i++) {
+      buffers_.push_back(BufferSlice(64));
+    }
+  }
+  void run(int n) override {
+    for (int i = 0; i < n; i += static_cast<int>(burst_size_)) {
+      for (auto &buffer : buffers_) {
+        queue_.push(UdpMessage{IPAddress(), std::move(buffer), Status::OK()});
+      }
+      buffers_.clear();
+      while (!queue_.empty()) {
+        // UdpWriter sends at most 16 messages at once
+        auto to_send = queue_.as_mutable_span();
+        to_send.truncate(td::min(to_send.size(), static_cast<size_t>(16)));
+        for (auto &message : to_send) {
+          buffers_.push_back(std::move(message.data));
+        }
+        queue_.pop_n(to_send.size());
+      }
+    }
+  }
+  void tear_down() override {
+    buffers_.clear();
+  }
+
+ private:
+  size_t burst_size_;
+  VectorQueue<UdpMessage> queue_;
+  std::vector<BufferSlice> buffers_;
+};
+
+TEST(Misc, UdpQueueBenchmark) {
+  for (size_t burst_size : {16, 256, 4096}) {
+    bench(UdpQueueBenchmark(burst_size));
+  }
+}
+
 TEST(Misc, CancellationToken) {
   CancellationTokenSource source;
   source.cancel();
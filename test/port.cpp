@@ -1,12 +1,19 @@
 #include "td/utils/common.h"
 #include "td/utils/logging.h"
 #include "td/utils/misc.h"
+#include "td/utils/port/CpuTopology.h"
 #include "td/utils/port/FileFd.h"
 #include "td/utils/port/path.h"
 #include "td/utils/port/signals.h"
+#include "td/utils/port/thread.h"
+#include "td/utils/port/ThreadOptions.h"
 #include "td/utils/Slice.h"
 #include "td/utils/tests.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+
 using namespace td;
 
 TEST(Port, files) {
@@ -84,6 +91,76 @@ TEST(Port, files) {
   ASSERT_STREQ("Habcd world?!", buf_slice.substr(0, 13));
 }
 
+TEST(Port, CpuTopology) {
+  ASSERT_EQ(vector<int32>({0, 1, 2, 3, 8, 10, 11}), parse_cpu_list("0-3,8,10-11\n").move_as_ok());
+  ASSERT_TRUE(parse_cpu_list("3-1").is_error());
+  ASSERT_TRUE(parse_cpu_list("a").is_error());
+
+  auto topology = get_cpu_topology().move_as_ok();
+  ASSERT_TRUE(!topology.cpus.empty());
+  ASSERT_TRUE(topology.get_physical_core_count() >= 1);
+  ASSERT_TRUE(topology.get_physical_core_count() <= topology.cpus.size());
+
+  auto order = topology.get_spread_order();
+  ASSERT_EQ(topology.cpus.size(), order.size());
+  std::sort(order.begin(), order.end());
+  for (size_t i = 0; i < order.size(); i++) {
+    ASSERT_EQ(topology.cpus[i].id, order[i]);
+  }
+
+  size_t node_cpus_n = 0;
+  for (auto node : topology.get_numa_nodes()) {
+    node_cpus_n += topology.get_numa_node_cpus(node).size();
+  }
+  ASSERT_EQ(topology.cpus.size(), node_cpus_n);
+
+  CpuTopology hyper_threading;
+  for (int32 i = 0; i < 8; i++) {
+    CpuTopology::Cpu cpu;
+    cpu.id = i;
+    cpu.core_id = i % 4;
+    cpu.numa_node = i % 4 / 2;
+    hyper_threading.cpus.push_back(cpu);
+  }
+  ASSERT_EQ(4u, hyper_threading.get_physical_core_count());
+  ASSERT_EQ(vector<int32>({0, 2, 1, 3, 4, 6, 5, 7}), hyper_threading.get_spread_order());
+  ASSERT_EQ(vector<int32>({2, 3, 6, 7}), hyper_threading.get_numa_node_cpus(1));
+}
+
+#if !TD_THREAD_UNSUPPORTED
+TEST(Port, ThreadOptions) {
+  auto topology = get_cpu_topology().move_as_ok();
+  ThreadOptions options;
+  options.cpu_set.push_back(topology.cpus.back().id);
+  options.stack_size = 1 << 17;
+  bool is_ok = false;
+  td::thread thread(std::move(options), [&] {
+    char buf[1 << 15];
+    std::fill(std::begin(buf), std::end(buf), 'a');
+    is_ok = buf[100] == 'a';
+  });
+  thread.join();
+  ASSERT_TRUE(is_ok);
+
+  ThreadOptions invalid_options;
+  invalid_options.cpu_set.push_back(-1);
+  ASSERT_TRUE(set_current_thread_options(invalid_options).is_error());
+  ASSERT_TRUE(set_current_thread_options(ThreadOptions()).is_ok());
+
+#if TD_LINUX
+  // the default priority is out of the range of real-time policies, so it must be clamped
+  ThreadOptions fifo_options;
+  fifo_options.scheduling_policy = ThreadOptions::SchedulingPolicy::Fifo;
+  td::thread fifo_thread([&] {
+    auto status = set_current_thread_options(fifo_options);
+    // changing the policy may be not permitted to the process
+    ASSERT_TRUE(status.is_ok() || status.code() == EPERM);
+  });
+  fifo_thread.join();
+#endif
+}
+#endif
+
 TEST(Port, Writev) {
   std::vector<IoSlice> vec;
   CSlice test_file_path = "test.txt";